@@ -0,0 +1,138 @@
+#include "AnalogOversampler.h"
+
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+
+bool AnalogOversampler::configure(uint8_t bits, uint8_t averaging)
+{
+  uint8_t avgShift = 0;
+
+  if ((bits < 12) || (bits > 16) || (averaging == 0) || (averaging > kMaxAveraging) ||
+      ((averaging & (averaging - 1)) != 0)) {
+    return false;
+  }
+  while ((1U << avgShift) < averaging) {
+    avgShift++;
+  }
+
+  shift_ = bits - 12;
+  ratio_ = (uint16_t)(1U << (2 * shift_));
+  averaging_ = averaging;
+  averagingShift_ = avgShift;
+  reset();
+  return true;
+}
+
+void AnalogOversampler::reset()
+{
+  acc_ = 0;
+  count_ = 0;
+  historySum_ = 0;
+  historyIndex_ = 0;
+  historyFill_ = 0;
+  for (uint8_t i = 0; i < kMaxAveraging; i++) {
+    history_[i] = 0;
+  }
+  available_ = false;
+}
+
+void AnalogOversampler::push(uint16_t sample)
+{
+  acc_ += sample;
+  if (++count_ >= ratio_) {
+    uint32_t value = acc_ >> shift_;
+    acc_ = 0;
+    count_ = 0;
+    emit(value);
+  }
+}
+
+void AnalogOversampler::feed(const uint16_t* samples, size_t count, size_t stride)
+{
+  if ((samples == nullptr) || (stride == 0)) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    push(*samples);
+    samples += stride;
+  }
+}
+
+void AnalogOversampler::emit(uint32_t value)
+{
+  if (averaging_ > 1) {
+    historySum_ += value - history_[historyIndex_];
+    history_[historyIndex_] = (uint16_t)value;
+    historyIndex_ = (historyIndex_ + 1) & (averaging_ - 1);
+    if (historyFill_ < averaging_) {
+      // Still filling up: average over what we have.
+      historyFill_++;
+      value = historySum_ / historyFill_;
+    } else {
+      value = historySum_ >> averagingShift_;
+    }
+  }
+
+  result_ = value;
+  available_ = true;
+  if (callback_ != nullptr) {
+    callback_(value);
+  }
+}
+
+uint32_t AnalogOversampler::read()
+{
+  available_ = false;
+  return result_;
+}
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && \
+    defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+
+AnalogOversampler* AnalogOversampler::s_active = nullptr;
+
+bool AnalogOversampler::begin(uint32_t pin, uint8_t bits, uint32_t outputRateHz,
+                              uint8_t averaging, TIM_TypeDef* timer)
+{
+  end();
+  if ((outputRateHz == 0) || (s_active != nullptr) || !configure(bits, averaging)) {
+    return false;
+  }
+
+  uint64_t sampleRate = (uint64_t)outputRateHz * ratio_;
+  if (sampleRate > 0xFFFFFFFFULL) {
+    return false;
+  }
+
+  s_active = this;
+  scanner_.onHalfComplete(handleBlock);
+  scanner_.onComplete(handleBlock);
+  if (!scanner_.begin(&pin, 1, (uint32_t)sampleRate, dmaBuffer_, kDmaFrames, timer)) {
+    s_active = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void AnalogOversampler::end()
+{
+  scanner_.end();
+  if (s_active == this) {
+    s_active = nullptr;
+  }
+}
+
+uint32_t AnalogOversampler::outputRate()
+{
+  return scanner_.sampleRate() / ratio_;
+}
+
+void AnalogOversampler::handleBlock(const uint16_t* block, size_t frames)
+{
+  if (s_active != nullptr) {
+    s_active->feed(block, frames);
+  }
+}
+
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+
+#include "AnalogScanner.h"
+
+// Oversampling and decimation of 12-bit ADC samples.
+//
+// Every extra bit of resolution costs 4x samples: for a result of `bits`
+// bits (12..16) the decimator sums ratio() = 4^(bits - 12) raw samples and
+// shifts the sum right by (bits - 12). An optional moving average over the
+// last 2/4/8/16 results smooths the output further without changing its
+// rate. The extra bits are only meaningful when the input carries some noise
+// (at least ~1 LSB), which is normally the case.
+//
+// Samples come either from begin(), where a timer-triggered DMA stream feeds
+// the decimator in the background at outputRateHz * ratio(), or from any
+// other source through push()/feed() (analogRead(), AnalogScanner blocks...).
+class AnalogOversampler {
+public:
+  // Called with each new result, from interrupt context when running
+  // with begin().
+  typedef void (*ResultCallback)(uint32_t value);
+
+  // bits: 12..16 result resolution.
+  // averaging: moving average length over results, 1, 2, 4, 8 or 16.
+  bool configure(uint8_t bits, uint8_t averaging = 1);
+  void reset();
+
+  void push(uint16_t sample);
+  // Feed count samples taken every stride entries of samples, e.g. one
+  // channel out of an interleaved AnalogScanner block.
+  void feed(const uint16_t* samples, size_t count, size_t stride = 1);
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && \
+    defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+  // Background mode: pin is sampled by timer-triggered DMA conversions and
+  // decimated in the DMA interrupt. Owns the ADC like AnalogScanner does.
+  bool begin(uint32_t pin, uint8_t bits, uint32_t outputRateHz,
+             uint8_t averaging = 1, TIM_TypeDef* timer = TIM1);
+  void end();
+
+  // Actual output data rate, as reachable by the timer.
+  uint32_t outputRate();
+#endif
+
+  // True once a result is waiting; read() clears it.
+  bool available() const { return available_; }
+  // Latest result, in bits() bits.
+  uint32_t read();
+
+  uint8_t bits() const { return 12 + shift_; }
+  uint16_t ratio() const { return ratio_; }
+
+  void onResult(ResultCallback callback) { callback_ = callback; }
+
+private:
+  void emit(uint32_t value);
+
+  static const uint8_t kMaxAveraging = 16;
+
+  uint32_t acc_ = 0;
+  uint16_t count_ = 0;
+  uint16_t ratio_ = 1;
+  uint8_t shift_ = 0;
+
+  uint16_t history_[kMaxAveraging] = {};
+  uint32_t historySum_ = 0;
+  uint8_t historyIndex_ = 0;
+  uint8_t historyFill_ = 0;
+  uint8_t averaging_ = 1;
+  uint8_t averagingShift_ = 0;
+
+  volatile uint32_t result_ = 0;
+  volatile bool available_ = false;
+  ResultCallback callback_ = nullptr;
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && \
+    defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+  static void handleBlock(const uint16_t* block, size_t frames);
+  static AnalogOversampler* s_active;
+
+  static const size_t kDmaFrames = 32;
+  AnalogScanner scanner_;
+  uint16_t dmaBuffer_[kDmaFrames] = {};
+#endif
+};
+
+#endif
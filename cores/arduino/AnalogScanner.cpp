@@ -0,0 +1,242 @@
+#include "Arduino.h"
+#include "AnalogScanner.h"
+
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY) && \
+    defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && \
+    defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+
+#include "HardwareTimer.h"
+#include "py32/analog.h"
+#if defined(HAL_COMP_MODULE_ENABLED) && defined(SYSCFG_CFGR2_ETR_SRC_TIM1)
+#include "py32yyxx_ll_system.h"
+#endif
+
+AnalogScanner* AnalogScanner::s_active = nullptr;
+
+static uint32_t pinToChannel(uint32_t pin)
+{
+  PinName p = analogInputToPinName(pin);
+  uint32_t bank = 0;
+
+  if (p == NC) {
+    return (uint32_t)-1;
+  }
+  if ((p & PADC_BASE) && (p < ANA_START)) {
+    return get_adc_internal_channel(p);
+  }
+  if ((ADC_TypeDef*)pinmap_peripheral(p, PinMap_ADC) != ADC1) {
+    return (uint32_t)-1;
+  }
+  return get_adc_channel(p, &bank);
+}
+
+static uint8_t popCount(uint32_t v)
+{
+  uint8_t n = 0;
+  while (v != 0) {
+    v &= v - 1;
+    n++;
+  }
+  return n;
+}
+
+bool AnalogScanner::begin(const uint32_t* pins, uint8_t count, uint32_t sampleRateHz,
+                          uint16_t* buffer, size_t frames, TIM_TypeDef* timer)
+{
+  PinName names[32];
+  uint32_t trigger;
+
+  end();
+  if ((pins == nullptr) || (count == 0) || (count > 32) || (buffer == nullptr) ||
+      (frames < 2) || ((frames & 1) != 0) || (sampleRateHz == 0) || (s_active != nullptr)) {
+    return false;
+  }
+
+  if (timer == TIM1) {
+    trigger = ADC_EXTERNALTRIGCONV_T1_TRGO;
+#if defined(TIM3)
+  } else if (timer == TIM3) {
+    trigger = ADC_EXTERNALTRIGCONV_T3_TRGO;
+#endif
+  } else {
+    return false;
+  }
+
+  channelMask_ = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    uint32_t channel = pinToChannel(pins[i]);
+    if (channel > 31) {
+      return false;
+    }
+    channelMask_ |= 1UL << channel;
+    names[i] = analogInputToPinName(pins[i]);
+  }
+  channels_ = popCount(channelMask_);
+  buffer_ = buffer;
+  frames_ = frames;
+  blockIndex_ = 0;
+  burstBlocks_ = 0;
+
+  // Reuse the timer object if the core already has one for this instance.
+  uint32_t index = get_timer_index(timer);
+  if (index != UNKNOWN_TIMER && HardwareTimer_Handle[index] != NULL && HardwareTimer_Handle[index]->__this != NULL) {
+    timer_ = (HardwareTimer*)HardwareTimer_Handle[index]->__this;
+    ownsTimer_ = false;
+  } else {
+    timer_ = new HardwareTimer(timer);
+    ownsTimer_ = true;
+  }
+  timer_->pause();
+  timer_->setOverflow(sampleRateHz, HERTZ_FORMAT);
+  LL_TIM_SetTriggerOutput(timer, LL_TIM_TRGO_UPDATE);
+
+  s_active = this;
+  if (!adc_stream_start(names, count, trigger, buffer_, (uint32_t)(frames_ * channels_), _handleBlock)) {
+    s_active = nullptr;
+    end();
+    return false;
+  }
+  running_ = true;
+  timer_->resume();
+  return true;
+}
+
+void AnalogScanner::end()
+{
+  if (running_) {
+    running_ = false;
+    adc_stream_stop();
+  }
+  stalled_ = false;
+  if (s_active == this) {
+    s_active = nullptr;
+  }
+  if (timer_ != nullptr) {
+    timer_->pause();
+#if defined(HAL_COMP_MODULE_ENABLED) && defined(SYSCFG_CFGR2_ETR_SRC_TIM1)
+    if (burstBlocks_ != 0) {
+      burstBlocks_ = 0;
+      LL_TIM_SetSlaveMode(timer_->getHandle()->Instance, LL_TIM_SLAVEMODE_DISABLED);
+      LL_SYSCFG_SetTIM1ETRSource(LL_SYSCFG_ETR_SRC_TIM1_GPIO);
+    }
+#endif
+    LL_TIM_SetTriggerOutput(timer_->getHandle()->Instance, LL_TIM_TRGO_RESET);
+    if (ownsTimer_) {
+      delete timer_;
+    }
+    timer_ = nullptr;
+    ownsTimer_ = false;
+  }
+}
+
+int AnalogScanner::indexOf(uint32_t pin) const
+{
+  uint32_t channel = pinToChannel(pin);
+
+  if ((channel > 31) || ((channelMask_ & (1UL << channel)) == 0)) {
+    return -1;
+  }
+  return popCount(channelMask_ & ((1UL << channel) - 1));
+}
+
+#if defined(HAL_COMP_MODULE_ENABLED) && defined(SYSCFG_CFGR2_ETR_SRC_TIM1)
+bool AnalogScanner::triggerOnComparator(uint8_t comparator, uint32_t edge, uint32_t blocks)
+{
+  uint32_t source;
+
+  if (!running() || (timer_->getHandle()->Instance != TIM1) || (blocks == 0) ||
+      ((edge != RISING) && (edge != FALLING))) {
+    return false;
+  }
+  if (comparator == 1) {
+    source = LL_SYSCFG_ETR_SRC_TIM1_COMP1;
+  } else if (comparator == 2) {
+    source = LL_SYSCFG_ETR_SRC_TIM1_COMP2;
+  } else {
+    return false;
+  }
+
+  timer_->pause();
+  burstBlocks_ = blocks;
+  blockIndex_ = 0;
+
+  __HAL_RCC_SYSCFG_CLK_ENABLE();
+  LL_SYSCFG_SetTIM1ETRSource(source);
+  LL_TIM_ConfigETR(TIM1, (edge == FALLING) ? LL_TIM_ETR_POLARITY_INVERTED : LL_TIM_ETR_POLARITY_NONINVERTED,
+                   LL_TIM_ETR_PRESCALER_DIV1, LL_TIM_ETR_FILTER_FDIV1);
+  LL_TIM_SetTriggerInput(TIM1, LL_TIM_TS_ETRF);
+  LL_TIM_SetSlaveMode(TIM1, LL_TIM_SLAVEMODE_TRIGGER);
+
+  // Counter and prescaler from zero; the update this generates may trigger
+  // one conversion, dropped by the rewind.
+  LL_TIM_GenerateEvent_UPDATE(TIM1);
+  if (!adc_stream_rewind()) {
+    stalled_ = true;
+    return false;
+  }
+  return true;
+}
+
+bool AnalogScanner::freeRun()
+{
+  if (!running() || (burstBlocks_ == 0)) {
+    return false;
+  }
+  burstBlocks_ = 0;
+  LL_TIM_DisableCounter(TIM1);
+  LL_TIM_SetSlaveMode(TIM1, LL_TIM_SLAVEMODE_DISABLED);
+  LL_SYSCFG_SetTIM1ETRSource(LL_SYSCFG_ETR_SRC_TIM1_GPIO);
+  blockIndex_ = 0;
+  if (!adc_stream_rewind()) {
+    stalled_ = true;
+    return false;
+  }
+  timer_->resume();
+  return true;
+}
+
+bool AnalogScanner::armed() const
+{
+  return running() && (burstBlocks_ != 0) && !LL_TIM_IsEnabledCounter(TIM1);
+}
+#endif
+
+uint32_t AnalogScanner::sampleRate()
+{
+  return (timer_ != nullptr) ? timer_->getOverflow(HERTZ_FORMAT) : 0;
+}
+
+void AnalogScanner::_handleBlock(uint8_t half)
+{
+  AnalogScanner* self = s_active;
+  if (self == nullptr) {
+    return;
+  }
+
+  size_t first = self->frames_ / 2;
+  if (half) {
+    if (self->halfCallback_ != nullptr) {
+      self->halfCallback_(self->buffer_, first);
+    }
+  } else {
+    if (self->fullCallback_ != nullptr) {
+      self->fullCallback_(self->buffer_ + first * self->channels_, self->frames_ - first);
+    }
+  }
+  self->blockIndex_++;
+
+#if defined(HAL_COMP_MODULE_ENABLED) && defined(SYSCFG_CFGR2_ETR_SRC_TIM1)
+  if ((self->burstBlocks_ != 0) && (self->blockIndex_ >= self->burstBlocks_)) {
+    // End of burst: stop, clear counter and prescaler, wait for the next edge.
+    LL_TIM_DisableCounter(TIM1);
+    LL_TIM_GenerateEvent_UPDATE(TIM1);
+    if (!adc_stream_rewind()) {
+      // ADC stalled: the timer stays stopped, end() cleans up
+      self->stalled_ = true;
+    }
+    self->blockIndex_ = 0;
+  }
+#endif
+}
+
+#endif
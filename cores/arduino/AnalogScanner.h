@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY) && \
+    defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && \
+    defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+
+// Timer-triggered multi-channel ADC scan.
+//
+// A HardwareTimer update event (TRGO) starts one conversion of the whole
+// channel sequence; DMA stores the samples in a circular buffer. Half- and
+// full-buffer callbacks hand out blocks of complete sequences, so there is no
+// per-sample CPU work. While a scan is running the ADC is owned by it and
+// analogRead() returns 0.
+//
+// The sequencer converts channels in ascending ADC channel order, whatever the
+// order of the pins passed to begin(): use indexOf() to locate a pin inside a
+// sequence.
+class AnalogScanner {
+public:
+  // block: first sample of the half buffer just filled.
+  // frames: number of sequences in the block (channels() samples each).
+  typedef void (*BlockCallback)(const uint16_t* block, size_t frames);
+
+  // pins: analog pins (PA0, A1, AVREF, ATEMP...), all on ADC1.
+  // sampleRateHz: sequences per second.
+  // buffer: frames * channels() samples, frames must be even.
+  // timer: TIM1 (default) or TIM3, whose TRGO can trigger the ADC.
+  // Fails while an analogReadBegin() session is running: analogReadEnd()
+  // first. The scanner owns the ADC: analogRead() returns 0 until end().
+  bool begin(const uint32_t* pins, uint8_t count, uint32_t sampleRateHz,
+             uint16_t* buffer, size_t frames, TIM_TypeDef* timer = TIM1);
+  void end();
+
+  // Called from the DMA interrupt. Set them before begin().
+  void onHalfComplete(BlockCallback callback) { halfCallback_ = callback; }
+  void onComplete(BlockCallback callback) { fullCallback_ = callback; }
+
+  // Number of the block being handed to a callback: counts half buffers since
+  // begin(), or since the start of the current burst.
+  uint32_t blockIndex() const { return blockIndex_; }
+
+#if defined(HAL_COMP_MODULE_ENABLED) && defined(SYSCFG_CFGR2_ETR_SRC_TIM1)
+  // Burst capture started by a comparator output edge, without software in
+  // the path: COMP1/COMP2 is routed to TIM1 ETR, whose edge starts the
+  // counter in hardware (slave trigger mode). Sequence n of a burst is
+  // converted exactly n + 1 timer periods after the edge. After `blocks`
+  // half buffers the timer stops and the scanner waits for the next edge,
+  // refilling the buffer from its start. The ADC itself can only be
+  // triggered by TIM1/TIM3, hence the detour through TIM1.
+  // Requires begin() with TIM1; the Comparator must be started separately.
+  // comparator: 1 or 2. edge: RISING or FALLING.
+  bool triggerOnComparator(uint8_t comparator, uint32_t edge = RISING, uint32_t blocks = 2);
+
+  // Leave comparator bursts and run freely again. False if not in bursts,
+  // or if the ADC stalled (see running()).
+  bool freeRun();
+
+  // True while waiting for a comparator edge.
+  bool armed() const;
+#endif
+
+  // Position of pin in a sequence, -1 if not scanned.
+  int indexOf(uint32_t pin) const;
+
+  // Number of samples per sequence.
+  uint8_t channels() const { return channels_; }
+
+  // Actual sequence rate, as reachable by the timer.
+  uint32_t sampleRate();
+
+  // False after end(), and once the ADC stalled while the stream was
+  // rewound (comparator bursts): call end() and begin() again.
+  bool running() const { return running_ && !stalled_; }
+
+  // Internal: DMA half/full transfer entrypoint
+  static void _handleBlock(uint8_t half);
+
+private:
+  static AnalogScanner* s_active;
+
+  HardwareTimer* timer_ = nullptr;
+  bool ownsTimer_ = false;
+
+  uint16_t* buffer_ = nullptr;
+  size_t frames_ = 0;
+  uint32_t channelMask_ = 0;
+  uint8_t channels_ = 0;
+
+  BlockCallback halfCallback_ = nullptr;
+  BlockCallback fullCallback_ = nullptr;
+
+  bool running_ = false;
+  volatile bool stalled_ = false;
+
+  volatile uint32_t blockIndex_ = 0;
+  uint32_t burstBlocks_ = 0;
+};
+
+#endif
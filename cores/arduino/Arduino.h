@@ -41,6 +41,17 @@
   #include "Tone.h"
   #include "WSerial.h"
   #include "Comparator.h"
+  #include "HardwareCRC.h"
+  #include "AnalogScanner.h"
+  #include "AnalogOversampler.h"
+  #include "SoftwarePWM.h"
+  #include "PulseCapture.h"
+  #include "QuadratureEncoder.h"
+  #include "TimerWaveform.h"
+  #include "ComplementaryPWM.h"
+  #include "Timer32.h"
+  #include "TimerWheel.h"
+  #include "PolyTone.h"
 
   // Convenience frequency literals for sketches.
   // Example: 250_kHz, 1_MHz
@@ -1,20 +1,32 @@
 #include "Comparator.h"
+#include "analog.h"
 
-#if defined(HAL_COMP_MODULE_ENABLED)
+#if defined(HAL_COMP_MODULE_ENABLED) || \
+    (defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY))
 
 // PY32F0xx startup varies:
 // - Some parts use ADC_COMP_IRQHandler
 // - PY32F002A startup uses ADC_IRQHandler for the shared ADC&COMP vector
-// Provide both and forward to Comparator dispatcher.
+// Provide both and forward to the Comparator and ADC dispatchers.
 
-extern "C" void ADC_IRQHandler(void)
+static inline void adcCompDispatch(void)
 {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+  adc_irq_handler();
+#endif
+#if defined(HAL_COMP_MODULE_ENABLED)
   Comparator::_handleIRQ();
+#endif
+}
+
+extern "C" void ADC_IRQHandler(void)
+{
+  adcCompDispatch();
 }
 
 extern "C" void ADC_COMP_IRQHandler(void)
 {
-  Comparator::_handleIRQ();
+  adcCompDispatch();
 }
 
-#endif // HAL_COMP_MODULE_ENABLED
+#endif // HAL_COMP_MODULE_ENABLED || HAL_ADC_MODULE_ENABLED
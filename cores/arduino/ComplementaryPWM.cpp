@@ -0,0 +1,288 @@
+#include "Arduino.h"
+#include "ComplementaryPWM.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && defined(TIM_BDTR_DTG)
+
+#include "HardwareTimer.h"
+#include "py32yyxx_ll_system.h"
+
+static const uint32_t highChannels[] = {
+  LL_TIM_CHANNEL_CH1,
+  LL_TIM_CHANNEL_CH2,
+  LL_TIM_CHANNEL_CH3,
+};
+
+static const uint32_t lowChannels[] = {
+  LL_TIM_CHANNEL_CH1N,
+  LL_TIM_CHANNEL_CH2N,
+  LL_TIM_CHANNEL_CH3N,
+};
+
+// Route pin to TIM1 channel, as its direct or complementary output.
+static bool routePin(uint32_t pin, uint8_t channel, bool complementary)
+{
+  PinName p = digitalPinToPinName(pin);
+
+  if ((p == NC) || ((TIM_TypeDef*)pinmap_peripheral(p, PinMap_TIM) != TIM1)) {
+    return false;
+  }
+  uint32_t function = pinmap_function(p, PinMap_TIM);
+  if ((PY32_PIN_CHANNEL(function) != channel) || ((PY32_PIN_INVERTED(function) != 0) != complementary)) {
+    return false;
+  }
+  pinmap_pinout(p, PinMap_TIM);
+  return true;
+}
+
+// Dead-time generator encoding (BDTR.DTG) of ticks of tDTS, rounded up.
+static bool encodeDeadTime(uint32_t ticks, uint8_t* dtg, uint32_t* actual)
+{
+  uint32_t n;
+
+  if (ticks <= 127) {
+    *dtg = (uint8_t)ticks;
+    *actual = ticks;
+  } else if (ticks <= 254) {
+    n = (ticks + 1) / 2;
+    *dtg = (uint8_t)(0x80 | (n - 64));
+    *actual = n * 2;
+  } else if (ticks <= 504) {
+    n = (ticks + 7) / 8;
+    *dtg = (uint8_t)(0xC0 | (n - 32));
+    *actual = n * 8;
+  } else if (ticks <= 1008) {
+    n = (ticks + 15) / 16;
+    *dtg = (uint8_t)(0xE0 | (n - 32));
+    *actual = n * 16;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ComplementaryPWM::begin(uint32_t frequencyHz, bool centerAligned)
+{
+  end();
+  if (frequencyHz == 0) {
+    return false;
+  }
+
+  // Reuse the timer object if the core already has one for this instance.
+  uint32_t index = get_timer_index(TIM1);
+  if (index != UNKNOWN_TIMER && HardwareTimer_Handle[index] != NULL && HardwareTimer_Handle[index]->__this != NULL) {
+    timer_ = (HardwareTimer*)HardwareTimer_Handle[index]->__this;
+    ownsTimer_ = false;
+  } else {
+    timer_ = new HardwareTimer(TIM1);
+    ownsTimer_ = true;
+  }
+
+  // Center-aligned: the counter goes up then down, two ticks per step.
+  uint32_t ticks = timer_->getTimerClkFreq() / frequencyHz;
+  if (centerAligned) {
+    ticks /= 2;
+  }
+  if (ticks < 2) {
+    end();
+    return false;
+  }
+  uint32_t prescaler = ticks / 0x10000 + 1;
+  uint32_t steps = ticks / prescaler;
+
+  centerAligned_ = centerAligned;
+  resolution_ = (uint16_t)((steps > 0xFFFF) ? 0xFFFF : steps);
+
+  timer_->pause();
+  timer_->setPrescaleFactor(prescaler);
+  LL_TIM_SetCounterMode(TIM1, centerAligned ? LL_TIM_COUNTERMODE_CENTER_UP_DOWN : LL_TIM_COUNTERMODE_UP);
+  LL_TIM_SetAutoReload(TIM1, centerAligned ? resolution_ : resolution_ - 1);
+  LL_TIM_EnableARRPreload(TIM1);
+  // One update per triangle, at its bottom, in center-aligned mode.
+  LL_TIM_SetRepetitionCounter(TIM1, centerAligned ? 1 : 0);
+  // Disabled or broken outputs are driven to their idle level (low).
+  LL_TIM_SetOffStates(TIM1, LL_TIM_OSSI_ENABLE, LL_TIM_OSSR_ENABLE);
+
+  for (uint8_t i = 0; i < 3; i++) {
+    LL_TIM_OC_SetMode(TIM1, highChannels[i], LL_TIM_OCMODE_PWM1);
+    LL_TIM_OC_EnablePreload(TIM1, highChannels[i]);
+    LL_TIM_OC_SetPolarity(TIM1, highChannels[i], LL_TIM_OCPOLARITY_HIGH);
+    LL_TIM_OC_SetPolarity(TIM1, lowChannels[i], LL_TIM_OCPOLARITY_HIGH);
+    LL_TIM_OC_SetIdleState(TIM1, highChannels[i], LL_TIM_OCIDLESTATE_LOW);
+    LL_TIM_OC_SetIdleState(TIM1, lowChannels[i], LL_TIM_OCIDLESTATE_LOW);
+  }
+  TIM1->CCR1 = 0;
+  TIM1->CCR2 = 0;
+  TIM1->CCR3 = 0;
+
+  LL_TIM_GenerateEvent_UPDATE(TIM1);
+  LL_TIM_EnableAllOutputs(TIM1);
+  LL_TIM_EnableCounter(TIM1);
+  return true;
+}
+
+void ComplementaryPWM::end()
+{
+  if (timer_ == nullptr) {
+    return;
+  }
+  LL_TIM_DisableAllOutputs(TIM1);
+  LL_TIM_CC_DisableChannel(TIM1, LL_TIM_CHANNEL_CH1 | LL_TIM_CHANNEL_CH1N |
+                           LL_TIM_CHANNEL_CH2 | LL_TIM_CHANNEL_CH2N |
+                           LL_TIM_CHANNEL_CH3 | LL_TIM_CHANNEL_CH3N);
+  timer_->pause();
+  // Back to the reset configuration, for a later plain HardwareTimer on TIM1
+  CLEAR_BIT(TIM1->BDTR, TIM_BDTR_BKE | TIM_BDTR_BKP | TIM_BDTR_AOE | TIM_BDTR_DTG |
+            TIM_BDTR_OSSI | TIM_BDTR_OSSR);
+  LL_TIM_DisableARRPreload(TIM1);
+  LL_TIM_SetCounterMode(TIM1, LL_TIM_COUNTERMODE_UP);
+  LL_TIM_SetRepetitionCounter(TIM1, 0);
+  LL_TIM_SetClockDivision(TIM1, LL_TIM_CLOCKDIVISION_DIV1);
+  if (ownsTimer_) {
+    delete timer_;
+  }
+  timer_ = nullptr;
+  ownsTimer_ = false;
+}
+
+bool ComplementaryPWM::attachPhase(uint8_t channel, uint32_t pinHigh, uint32_t pinLow)
+{
+  uint32_t outputs = 0;
+
+  if ((timer_ == nullptr) || (channel < 1) || (channel > 3)) {
+    return false;
+  }
+  if (pinHigh != NUM_DIGITAL_PINS) {
+    if (!routePin(pinHigh, channel, false)) {
+      return false;
+    }
+    outputs |= highChannels[channel - 1];
+  }
+  if (pinLow != NUM_DIGITAL_PINS) {
+    if (!routePin(pinLow, channel, true)) {
+      return false;
+    }
+    outputs |= lowChannels[channel - 1];
+  }
+  LL_TIM_CC_EnableChannel(TIM1, outputs);
+  return true;
+}
+
+uint32_t ComplementaryPWM::setDeadTime(uint32_t ns)
+{
+  static const uint32_t divisions[] = {
+    LL_TIM_CLOCKDIVISION_DIV1,
+    LL_TIM_CLOCKDIVISION_DIV2,
+    LL_TIM_CLOCKDIVISION_DIV4,
+  };
+
+  if (timer_ == nullptr) {
+    return 0;
+  }
+  uint32_t clock = timer_->getTimerClkFreq();
+  uint64_t ticks = ((uint64_t)ns * clock + 999999999) / 1000000000;
+
+  // Longer dead times need a slower tDTS, which also slows the input
+  // filters of the timer.
+  for (uint8_t shift = 0; shift < 3; shift++) {
+    uint64_t dts = (ticks + (1U << shift) - 1) >> shift;
+    uint8_t dtg;
+    uint32_t actual;
+
+    if ((dts <= 1008) && encodeDeadTime((uint32_t)dts, &dtg, &actual)) {
+      LL_TIM_SetClockDivision(TIM1, divisions[shift]);
+      LL_TIM_OC_SetDeadTime(TIM1, dtg);
+      return (uint32_t)(((uint64_t)(actual << shift) * 1000000000) / clock);
+    }
+  }
+  return 0;
+}
+
+void ComplementaryPWM::write(uint8_t channel, uint16_t duty)
+{
+  if ((timer_ == nullptr) || (channel < 1) || (channel > 3)) {
+    return;
+  }
+  (&TIM1->CCR1)[channel - 1] = (duty > resolution_) ? resolution_ : duty;
+}
+
+void ComplementaryPWM::writePhases(uint16_t u, uint16_t v, uint16_t w)
+{
+  if (timer_ == nullptr) {
+    return;
+  }
+  // No update event may load a mix of old and new duties.
+  LL_TIM_DisableUpdateEvent(TIM1);
+  TIM1->CCR1 = (u > resolution_) ? resolution_ : u;
+  TIM1->CCR2 = (v > resolution_) ? resolution_ : v;
+  TIM1->CCR3 = (w > resolution_) ? resolution_ : w;
+  LL_TIM_EnableUpdateEvent(TIM1);
+}
+
+void ComplementaryPWM::setBreak(uint32_t sources, bool activeHigh, bool autoRestart)
+{
+  uint32_t internal = 0;
+
+#if defined(SYSCFG_CFGR2_COMP1_BRK_TIM1)
+  if (sources & CPWM_BREAK_COMP1) {
+    internal |= LL_SYSCFG_TIMBREAK_COMP1_TO_TIM1;
+  }
+#endif
+#if defined(SYSCFG_CFGR2_COMP2_BRK_TIM1)
+  if (sources & CPWM_BREAK_COMP2) {
+    internal |= LL_SYSCFG_TIMBREAK_COMP2_TO_TIM1;
+  }
+#endif
+#if defined(SYSCFG_CFGR2_LOCKUP_LOCK)
+  // Write-once: stays enabled until reset.
+  if (sources & CPWM_BREAK_LOCKUP) {
+    internal |= LL_SYSCFG_TIMBREAK_LOCKUP_TO_ALL;
+  }
+#endif
+  __HAL_RCC_SYSCFG_CLK_ENABLE();
+#if defined(SYSCFG_CFGR2_COMP1_BRK_TIM1)
+  LL_SYSCFG_DisableTIMBreakInputs(LL_SYSCFG_TIMBREAK_COMP1_TO_TIM1);
+#endif
+#if defined(SYSCFG_CFGR2_COMP2_BRK_TIM1)
+  LL_SYSCFG_DisableTIMBreakInputs(LL_SYSCFG_TIMBREAK_COMP2_TO_TIM1);
+#endif
+  if (internal != 0) {
+    LL_SYSCFG_EnableTIMBreakInputs(internal);
+  }
+
+  MODIFY_REG(TIM1->BDTR, TIM_BDTR_BKE | TIM_BDTR_BKP | TIM_BDTR_AOE,
+             ((sources != 0) ? TIM_BDTR_BKE : 0) |
+             (activeHigh ? TIM_BDTR_BKP : 0) |
+             (autoRestart ? TIM_BDTR_AOE : 0));
+}
+
+void ComplementaryPWM::setBreakPin(uint32_t pin, uint32_t alternate)
+{
+  PinName p = digitalPinToPinName(pin);
+
+  if (p != NC) {
+    pin_function(p, PY32_PIN_DATA(PY32_MODE_AF_PP, GPIO_NOPULL, alternate));
+  }
+}
+
+bool ComplementaryPWM::breakTripped() const
+{
+  return LL_TIM_IsActiveFlag_BRK(TIM1) != 0;
+}
+
+void ComplementaryPWM::clearBreak()
+{
+  LL_TIM_ClearFlag_BRK(TIM1);
+  LL_TIM_EnableAllOutputs(TIM1);
+}
+
+void ComplementaryPWM::enableOutputs()
+{
+  LL_TIM_EnableAllOutputs(TIM1);
+}
+
+void ComplementaryPWM::disableOutputs()
+{
+  LL_TIM_DisableAllOutputs(TIM1);
+}
+
+#endif
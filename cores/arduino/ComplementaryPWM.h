@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && defined(TIM_BDTR_DTG)
+
+// Break sources for ComplementaryPWM::setBreak(), may be combined.
+typedef enum {
+  CPWM_BREAK_PIN    = 0x01,   // TIM1_BKIN pin, see setBreakPin()
+  CPWM_BREAK_COMP1  = 0x02,   // comparator 1 output
+  CPWM_BREAK_COMP2  = 0x04,   // comparator 2 output
+  CPWM_BREAK_LOCKUP = 0x08,   // CPU lockup (hard fault while in hard fault)
+} ComplementaryPWMBreak_t;
+
+// Motor-drive PWM on TIM1: up to three phases, each a high-side output (CHx)
+// and its complementary low-side output (CHxN), with hardware dead time.
+//
+// Edge- or center-aligned counting. In center-aligned mode the repetition
+// counter makes one update per PWM period, at the bottom of the triangle,
+// where new duties are loaded. writePhases() sets the three duties with
+// updates held off, so all of them take effect at the same update event.
+//
+// The break input (BKIN pin, comparators or CPU lockup) clears the main
+// output enable in hardware: all outputs go to their idle level, low,
+// within a few clock cycles, without any software. With auto-restart the
+// outputs come back at the first update event after the break goes away;
+// otherwise clearBreak() re-enables them.
+class ComplementaryPWM {
+public:
+  // frequencyHz: PWM frequency (full triangle in center-aligned mode).
+  bool begin(uint32_t frequencyHz, bool centerAligned = true);
+  void end();
+
+  // Route channel 1..3 to pinHigh (TIM1_CHx) and pinLow (TIM1_CHxN).
+  // Either may be NUM_DIGITAL_PINS to leave that output unused.
+  bool attachPhase(uint8_t channel, uint32_t pinHigh, uint32_t pinLow);
+
+  // Dead time inserted on each switching edge. Rounded up to what the
+  // generator can do; returns the actual value in ns, 0 if out of range.
+  uint32_t setDeadTime(uint32_t ns);
+
+  // Duty in ticks, 0..resolution().
+  void write(uint8_t channel, uint16_t duty);
+  // Three phase duties, all applied at the same update event.
+  void writePhases(uint16_t u, uint16_t v, uint16_t w);
+  uint16_t resolution() const { return resolution_; }
+
+  // sources: CPWM_BREAK_* flags, 0 to disable. activeHigh applies to the BKIN
+  // pin: configure it with setBreakPin() first, or an idle input may read
+  // as an active break.
+  void setBreak(uint32_t sources, bool activeHigh = false, bool autoRestart = false);
+  // Configure pin as TIM1_BKIN with the given GPIO alternate function.
+  void setBreakPin(uint32_t pin, uint32_t alternate);
+
+  // True once a break has occurred, until clearBreak().
+  bool breakTripped() const;
+  // Re-enable the outputs after a break (no effect while it is active).
+  void clearBreak();
+
+  // Main output enable, for all phases.
+  void enableOutputs();
+  void disableOutputs();
+
+private:
+  HardwareTimer* timer_ = nullptr;
+  bool ownsTimer_ = false;
+  bool centerAligned_ = false;
+  uint16_t resolution_ = 0;
+};
+
+#endif
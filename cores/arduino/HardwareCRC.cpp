@@ -0,0 +1,247 @@
+#include "HardwareCRC.h"
+
+#if defined(CRC_BASE)
+
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+#include "dma.h"
+
+// The DMA counter is 16-bit: longer buffers are fed in chunks.
+#define CRC_DMA_MAX_WORDS 0xFFFFU
+
+static DMA_HandleTypeDef crcDma;
+HardwareCRC* HardwareCRC::s_dmaOwner = nullptr;
+#endif
+
+// CRC-32/MPEG-2 nibble table, used to finish the 1..3 bytes that do not fill
+// a word for the hardware unit.
+static const uint32_t crc32Nibble[16] = {
+  0x00000000UL, 0x04C11DB7UL, 0x09823B6EUL, 0x0D4326D9UL,
+  0x130476DCUL, 0x17C56B6BUL, 0x1A864DB2UL, 0x1E475005UL,
+  0x2608EDB8UL, 0x22C9F00FUL, 0x2F8AD6D6UL, 0x2B4BCB61UL,
+  0x350C9B64UL, 0x31CD86D3UL, 0x3C8EA00AUL, 0x384FBDBDUL
+};
+
+// Nibble tables of the default CRC-8 (SMBus PEC) and CRC-16 (CCITT)
+// polynomials. Other polynomials get a table built on the stack per call, so
+// the functions hold no shared state and can be called from interrupts.
+static const uint8_t crc8Nibble07[16] = {
+  0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+  0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+static const uint16_t crc16Nibble1021[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+void HardwareCRC::begin()
+{
+  __HAL_RCC_CRC_CLK_ENABLE();
+  reset();
+}
+
+void HardwareCRC::end()
+{
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+  if (s_dmaOwner == this) {
+    dma_channel_release(&crcDma);
+    s_dmaOwner = nullptr;
+    dmaBusy_ = false;
+  }
+#endif
+  __HAL_RCC_CRC_CLK_DISABLE();
+}
+
+void HardwareCRC::reset()
+{
+  CRC->CR = CRC_CR_RESET;
+  pending_ = 0;
+  pendingLen_ = 0;
+}
+
+uint32_t HardwareCRC::update(const void* data, size_t len)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+
+  // Complete a partial word first
+  while ((pendingLen_ != 0) && (len != 0)) {
+    pending_ = (pending_ << 8) | *p++;
+    len--;
+    if (++pendingLen_ == 4) {
+      CRC->DR = pending_;
+      pending_ = 0;
+      pendingLen_ = 0;
+    }
+  }
+
+  // Bytes are assembled MSB first: no unaligned access on Cortex-M0+ and the
+  // result matches the byte-wise CRC-32/MPEG-2 definition.
+  while (len >= 4) {
+    CRC->DR = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    p += 4;
+    len -= 4;
+  }
+
+  while (len != 0) {
+    pending_ = (pending_ << 8) | *p++;
+    pendingLen_++;
+    len--;
+  }
+  return value();
+}
+
+uint32_t HardwareCRC::updateWords(const uint32_t* words, size_t count)
+{
+  if (pendingLen_ != 0) {
+    // Not word aligned anymore: go through the byte path.
+    while (count-- != 0) {
+      uint32_t w = *words++;
+      uint8_t b[4] = {(uint8_t)(w >> 24), (uint8_t)(w >> 16), (uint8_t)(w >> 8), (uint8_t)w};
+      update(b, 4);
+    }
+  } else {
+    while (count-- != 0) {
+      CRC->DR = *words++;
+    }
+  }
+  return value();
+}
+
+uint32_t HardwareCRC::value() const
+{
+  uint32_t crc = CRC->DR;
+  for (uint8_t i = pendingLen_; i != 0; i--) {
+    crc ^= ((pending_ >> ((i - 1) * 8)) & 0xFFUL) << 24;
+    crc = (crc << 4) ^ crc32Nibble[crc >> 28];
+    crc = (crc << 4) ^ crc32Nibble[crc >> 28];
+  }
+  return crc;
+}
+
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+bool HardwareCRC::updateWordsDMA(const uint32_t* words, size_t count, void (*callback)(uint32_t crc))
+{
+  if (dmaBusy_ || (pendingLen_ != 0) || ((s_dmaOwner != nullptr) && (s_dmaOwner != this))) {
+    return false;
+  }
+
+  if (s_dmaOwner == nullptr) {
+    if (dma_channel_claim(&crcDma) == NULL) {
+      return false;
+    }
+    // Memory to memory: the source is the "peripheral" side and increments,
+    // the destination is CRC->DR.
+    crcDma.Init.Direction = DMA_MEMORY_TO_MEMORY;
+    crcDma.Init.PeriphInc = DMA_PINC_ENABLE;
+    crcDma.Init.MemInc = DMA_MINC_DISABLE;
+    crcDma.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    crcDma.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    crcDma.Init.Mode = DMA_NORMAL;
+    crcDma.Init.Priority = DMA_PRIORITY_LOW;
+    if (HAL_DMA_Init(&crcDma) != HAL_OK) {
+      dma_channel_release(&crcDma);
+      return false;
+    }
+    crcDma.XferCpltCallback = _handleDMA;
+    s_dmaOwner = this;
+  }
+
+  dmaNext_ = words;
+  dmaRemaining_ = count;
+  dmaCallback_ = callback;
+  dmaBusy_ = true;
+  if (!startDMAChunk()) {
+    dmaBusy_ = false;
+    return false;
+  }
+  return true;
+}
+
+bool HardwareCRC::busy() const
+{
+  return dmaBusy_;
+}
+
+bool HardwareCRC::startDMAChunk()
+{
+  uint32_t chunk = (dmaRemaining_ > CRC_DMA_MAX_WORDS) ? CRC_DMA_MAX_WORDS : (uint32_t)dmaRemaining_;
+
+  if (chunk == 0) {
+    return false;
+  }
+  const uint32_t* src = dmaNext_;
+  dmaNext_ += chunk;
+  dmaRemaining_ -= chunk;
+  return HAL_DMA_Start_IT(&crcDma, (uint32_t)src, (uint32_t)&CRC->DR, chunk) == HAL_OK;
+}
+
+void HardwareCRC::_handleDMA(DMA_HandleTypeDef* hdma)
+{
+  (void)hdma;
+  HardwareCRC* self = s_dmaOwner;
+
+  if (self == nullptr) {
+    return;
+  }
+  if ((self->dmaRemaining_ != 0) && self->startDMAChunk()) {
+    return;
+  }
+  self->dmaBusy_ = false;
+  if (self->dmaCallback_ != nullptr) {
+    self->dmaCallback_(CRC->DR);
+  }
+}
+#endif
+
+uint8_t HardwareCRC::crc8(const void* data, size_t len, uint8_t poly, uint8_t init)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint8_t* crc8Nibble = crc8Nibble07;
+  uint8_t table[16];
+
+  if (poly != 0x07) {
+    for (uint8_t n = 0; n < 16; n++) {
+      uint8_t c = n << 4;
+      for (uint8_t b = 0; b < 4; b++) {
+        c = (c & 0x80) ? (uint8_t)((c << 1) ^ poly) : (uint8_t)(c << 1);
+      }
+      table[n] = c;
+    }
+    crc8Nibble = table;
+  }
+
+  uint8_t crc = init;
+  while (len-- != 0) {
+    crc ^= *p++;
+    crc = (uint8_t)(crc << 4) ^ crc8Nibble[crc >> 4];
+    crc = (uint8_t)(crc << 4) ^ crc8Nibble[crc >> 4];
+  }
+  return crc;
+}
+
+uint16_t HardwareCRC::crc16(const void* data, size_t len, uint16_t poly, uint16_t init)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint16_t* crc16Nibble = crc16Nibble1021;
+  uint16_t table[16];
+
+  if (poly != 0x1021) {
+    for (uint8_t n = 0; n < 16; n++) {
+      uint16_t c = (uint16_t)n << 12;
+      for (uint8_t b = 0; b < 4; b++) {
+        c = (c & 0x8000) ? (uint16_t)((c << 1) ^ poly) : (uint16_t)(c << 1);
+      }
+      table[n] = c;
+    }
+    crc16Nibble = table;
+  }
+
+  uint16_t crc = init;
+  while (len-- != 0) {
+    crc ^= (uint16_t)(*p++) << 8;
+    crc = (uint16_t)(crc << 4) ^ crc16Nibble[crc >> 12];
+    crc = (uint16_t)(crc << 4) ^ crc16Nibble[crc >> 12];
+  }
+  return crc;
+}
+
+#endif // CRC_BASE
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(CRC_BASE)
+
+// Hardware CRC unit.
+//
+// The PY32F0xx CRC peripheral implements a single fixed algorithm:
+// CRC-32/MPEG-2 (poly 0x04C11DB7, init 0xFFFFFFFF, MSB first, no final XOR).
+// Polynomial, init value and bit reflection are not configurable, so CRC-8
+// and CRC-16 are computed by a nibble-table software engine instead (SMBus
+// PEC, CCITT, Modbus-style framing...). They keep no state and are ISR-safe.
+//
+// There is only one CRC unit: one CRC-32 stream can be in progress at a time.
+class HardwareCRC {
+public:
+  // Enable the CRC clock and start a new CRC-32.
+  void begin();
+  void end();
+
+  // Start a new CRC-32 (init 0xFFFFFFFF).
+  void reset();
+
+  // Feed a byte stream, MSB of each byte first. Lengths do not have to be a
+  // multiple of 4: up to 3 trailing bytes are kept and merged with the next
+  // update(). Returns the CRC of all bytes fed since reset().
+  uint32_t update(const void* data, size_t len);
+
+  // Feed 32-bit words as values (the native input of the unit, no byte
+  // reordering): word W gives the same CRC as its bytes W>>24 .. W.
+  uint32_t updateWords(const uint32_t* words, size_t count);
+
+  // CRC of everything fed since reset().
+  uint32_t value() const;
+
+  // One-shot CRC-32/MPEG-2 of a byte buffer.
+  uint32_t calculate(const void* data, size_t len)
+  {
+    reset();
+    return update(data, len);
+  }
+
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+  // Bulk mode: feed count words by memory-to-memory DMA into the CRC unit,
+  // the CPU is free meanwhile. Same result as updateWords(). The buffer must
+  // stay valid until busy() returns false; callback, if any, is called from
+  // the DMA interrupt with the resulting CRC. Returns false when a transfer is
+  // already running, bytes are pending or no DMA channel is free.
+  bool updateWordsDMA(const uint32_t* words, size_t count, void (*callback)(uint32_t crc) = nullptr);
+  bool busy() const;
+
+  // Internal: DMA transfer complete entrypoint
+  static void _handleDMA(DMA_HandleTypeDef* hdma);
+#endif
+
+  // Software CRC-8, MSB first. Pass the previous result as init to continue.
+  // Default parameters give the SMBus PEC (poly 0x07, init 0x00).
+  static uint8_t crc8(const void* data, size_t len, uint8_t poly = 0x07, uint8_t init = 0x00);
+
+  // Software CRC-16, MSB first. Default parameters give CRC-16/CCITT-FALSE
+  // (poly 0x1021, init 0xFFFF).
+  static uint16_t crc16(const void* data, size_t len, uint16_t poly = 0x1021, uint16_t init = 0xFFFF);
+
+private:
+  uint32_t pending_ = 0;
+  uint8_t pendingLen_ = 0;
+
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+  static HardwareCRC* s_dmaOwner;
+  const uint32_t* dmaNext_ = nullptr;
+  size_t dmaRemaining_ = 0;
+  void (*dmaCallback_)(uint32_t crc) = nullptr;
+  volatile bool dmaBusy_ = false;
+
+  bool startDMAChunk();
+#endif
+};
+
+#endif // CRC_BASE
@@ -562,6 +562,16 @@ size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
   return ret;
 }
 
+#if defined(CRC_BASE)
+size_t HardwareSerial::writeWithCRC(const uint8_t *buffer, size_t size, uint16_t poly, uint16_t init)
+{
+  uint16_t crc = HardwareCRC::crc16(buffer, size, poly, init);
+  uint8_t trailer[2] = {(uint8_t)(crc >> 8), (uint8_t)crc};
+
+  return write(buffer, size) + write(trailer, 2);
+}
+#endif
+
 size_t HardwareSerial::write(uint8_t c)
 {
   uint8_t buff = c;
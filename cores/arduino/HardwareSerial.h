@@ -145,6 +145,11 @@ class HardwareSerial : public Stream {
     }
     size_t write(const uint8_t *buffer, size_t size);
     using Print::write; // pull in write(str) from Print
+#if defined(CRC_BASE)
+    // Write a frame followed by its CRC-16 (MSB first), see HardwareCRC::crc16().
+    // Returns the number of bytes written, CRC included.
+    size_t writeWithCRC(const uint8_t *buffer, size_t size, uint16_t poly = 0x1021, uint16_t init = 0xFFFF);
+#endif
     operator bool()
     {
       return true;
@@ -90,10 +90,33 @@ typedef enum {
   PERCENT_COMPARE_FORMAT, // used for Dutycycle
 } TimerCompareFormat_t;
 
+typedef enum {
+  TIMER_TRGO_RESET,           // == LL_TIM_TRGO_RESET    UG bit (refresh())
+  TIMER_TRGO_ENABLE,          // == LL_TIM_TRGO_ENABLE   counter enable
+  TIMER_TRGO_UPDATE,          // == LL_TIM_TRGO_UPDATE   update event (rollover)
+  TIMER_TRGO_COMPARE_PULSE,   // == LL_TIM_TRGO_CC1IF    channel 1 capture or compare match
+  TIMER_TRGO_OC1REF,          // == LL_TIM_TRGO_OC1REF   channel 1 output level
+  TIMER_TRGO_OC2REF,          // == LL_TIM_TRGO_OC2REF   channel 2 output level
+  TIMER_TRGO_OC3REF,          // == LL_TIM_TRGO_OC3REF   channel 3 output level
+  TIMER_TRGO_OC4REF,          // == LL_TIM_TRGO_OC4REF   channel 4 output level
+} TimerMasterOutput_t;
+
+typedef enum {
+  TIMER_SLAVE_DISABLED,       // == LL_TIM_SLAVEMODE_DISABLED       free running on the timer clock
+  TIMER_SLAVE_RESET,          // == LL_TIM_SLAVEMODE_RESET          counter reset on each master trigger
+  TIMER_SLAVE_GATED,          // == LL_TIM_SLAVEMODE_GATED          counts while the master trigger is high
+  TIMER_SLAVE_TRIGGER,        // == LL_TIM_SLAVEMODE_TRIGGER        counter starts on the master trigger
+  TIMER_SLAVE_EXTERNAL_CLOCK, // == LL_TIM_CLOCKSOURCE_EXT_MODE1    counts master triggers (timer chaining)
+} TimerSlaveMode_t;
+
 #ifdef __cplusplus
 
 #include <functional>
-using callback_function_t = std::function<void(void)>;
+#include <type_traits>
+
+typedef std::function<void(void)> callback_function_t;
+// Interrupt callback with a context pointer, given back as its argument
+typedef void (*callback_arg_function_t)(void *arg);
 
 /* Class --------------------------------------------------------*/
 class HardwareTimer {
@@ -115,8 +138,28 @@ class HardwareTimer {
     void setOverflow(uint32_t val, TimerFormat_t format = TICK_FORMAT); // set AutoReload register depending on format provided
     uint32_t getOverflow(TimerFormat_t format = TICK_FORMAT); // return overflow depending on format provided
 
-    void setPWM(uint32_t channel, PinName pin, uint32_t frequency, uint32_t dutycycle, callback_function_t PeriodCallback = nullptr, callback_function_t CompareCallback = nullptr); // Set all in one command freq in HZ, Duty in percentage. Including both interrupt.
-    void setPWM(uint32_t channel, uint32_t pin, uint32_t frequency, uint32_t dutycycle, callback_function_t PeriodCallback = nullptr, callback_function_t CompareCallback = nullptr);
+    void setPWM(uint32_t channel, PinName pin, uint32_t frequency, uint32_t dutycycle, void (*PeriodCallback)(void) = nullptr, void (*CompareCallback)(void) = nullptr); // Set all in one command freq in HZ, Duty in percentage. Including both interrupt.
+    void setPWM(uint32_t channel, uint32_t pin, uint32_t frequency, uint32_t dutycycle, void (*PeriodCallback)(void) = nullptr, void (*CompareCallback)(void) = nullptr);
+    // Same with any other callable (lambda capturing state, std::function), see attachInterrupt()
+    template <typename P, typename C = void (*)(void), typename = typename std::enable_if<!(std::is_convertible<P, void (*)(void)>::value && std::is_convertible<C, void (*)(void)>::value)>::type>
+    void setPWM(uint32_t channel, PinName pin, uint32_t frequency, uint32_t dutycycle, P PeriodCallback, C CompareCallback = nullptr)
+    {
+      setMode(channel, TIMER_OUTPUT_COMPARE_PWM1, pin);
+      setOverflow(frequency, HERTZ_FORMAT);
+      setCaptureCompare(channel, dutycycle, PERCENT_COMPARE_FORMAT);
+      if (isCallbackSet(PeriodCallback)) {
+        attachInterrupt(PeriodCallback);
+      }
+      if (isCallbackSet(CompareCallback)) {
+        attachInterrupt(channel, CompareCallback);
+      }
+      resume();
+    }
+    template <typename P, typename C = void (*)(void), typename = typename std::enable_if<!(std::is_convertible<P, void (*)(void)>::value && std::is_convertible<C, void (*)(void)>::value)>::type>
+    void setPWM(uint32_t channel, uint32_t pin, uint32_t frequency, uint32_t dutycycle, P PeriodCallback, C CompareCallback = nullptr)
+    {
+      setPWM(channel, pinName(pin), frequency, dutycycle, PeriodCallback, CompareCallback);
+    }
 
     void setCount(uint32_t val, TimerFormat_t format = TICK_FORMAT); // set timer counter to value 'val' depending on format provided
     uint32_t getCount(TimerFormat_t format = TICK_FORMAT);  // return current counter value of timer depending on format provided
@@ -134,19 +177,39 @@ class HardwareTimer {
     void setInterruptPriority(uint32_t preemptPriority, uint32_t subPriority); // set interrupt priority
 
     //Add interrupt to period update
-    void attachInterrupt(callback_function_t callback); // Attach interrupt callback which will be called upon update event (timer rollover)
+    void attachInterrupt(void (*callback)(void)); // Attach interrupt callback which will be called upon update event (timer rollover)
+    void attachInterrupt(callback_arg_function_t callback, void *arg); // Same, callback(arg) is called
     void detachInterrupt();  // remove interrupt callback which was attached to update event
     bool hasInterrupt();  //returns true if a timer rollover interrupt has already been set
     //Add interrupt to capture/compare channel
-    void attachInterrupt(uint32_t channel, callback_function_t callback); // Attach interrupt callback which will be called upon compare match event of specified channel
+    void attachInterrupt(uint32_t channel, void (*callback)(void)); // Attach interrupt callback which will be called upon compare match event of specified channel
+    void attachInterrupt(uint32_t channel, callback_arg_function_t callback, void *arg); // Same, callback(arg) is called
     void detachInterrupt(uint32_t channel);  // remove interrupt callback which was attached to compare match event of specified channel
     bool hasInterrupt(uint32_t channel);  //returns true if an interrupt has already been set on the channel compare match
+    // Any other callable (lambda capturing state, std::function) is kept in
+    // a heap copy. Only compiled in by sketches that use it.
+    template <typename F, typename = typename std::enable_if<!std::is_convertible<F, void (*)(void)>::value>::type>
+    void attachInterrupt(F callback)
+    {
+      attachCallback(0, callFunction, new callback_function_t(callback), deleteFunction);
+    }
+    template <typename F, typename = typename std::enable_if<!std::is_convertible<F, void (*)(void)>::value>::type>
+    void attachInterrupt(uint32_t channel, F callback)
+    {
+      attachCallback(channel, callFunction, new callback_function_t(callback), deleteFunction);
+    }
     void timerHandleDeinit();  // Timer deinitialization
 
     // Refresh() is useful while timer is running after some registers update
     void refresh(void); // Generate update event to force all registers (Autoreload, prescaler, compare) to be taken into account
 
-    uint32_t getTimerClkFreq();  // return timer clock frequency in Hz.
+    // Master/slave synchronization over the internal trigger lines (TRGO to ITR)
+    bool setMasterOutput(TimerMasterOutput_t trgo); // select the event sent to slave timers, false if the timer cannot be a master
+    bool setSlaveMode(TimerSlaveMode_t mode, HardwareTimer *master = nullptr); // slave to master's TRGO, false if not connected
+    static bool resumeSynchronized(HardwareTimer *const timers[], uint32_t count); // resume timers[0] and start the others on the same clock edge
+
+    uint32_t getTimerClkFreq();  // return timer clock frequency in Hz, cached until clockChanged()
+    static void clockChanged();  // invalidate the cached timer clocks, call after changing the system clock
 
     static void captureCompareCallback(TIM_HandleTypeDef *htim); // Generic Capture and Compare callback which will call user callback
     static void updateCallback(TIM_HandleTypeDef *htim);  // Generic Update (rollover) callback which will call user callback
@@ -168,7 +231,54 @@ class HardwareTimer {
   private:
     TimerModes_t  _ChannelMode[TIMER_CHANNELS];
     timerObj_t _timerObj;
-    callback_function_t callbacks[1 + TIMER_CHANNELS]; //Callbacks: 0 for update, 1-4 for channels. (channel5/channel6, if any, doesn't have interrupt)
+    struct {
+      callback_arg_function_t function;
+      void *arg;
+      void (*release)(void *arg); // frees arg when the callback is replaced, if set
+    } callbacks[1 + TIMER_CHANNELS]; //Callbacks: 0 for update, 1-4 for channels. (channel5/channel6, if any, doesn't have interrupt)
+
+    void attachCallback(uint32_t channel, callback_arg_function_t callback, void *arg, void (*release)(void *arg));
+    void clearCallback(uint32_t channel);
+    static void callPlain(void *arg);
+    static PinName pinName(uint32_t pin); // digitalPinToPinName(), for the templates
+    // setPWM() callback presence, whatever its type
+    static bool isCallbackSet(std::nullptr_t)
+    {
+      return false;
+    }
+    static bool isCallbackSet(void (*callback)(void))
+    {
+      return callback != nullptr;
+    }
+    static bool isCallbackSet(const callback_function_t &callback)
+    {
+      return (bool)callback;
+    }
+    template <typename F>
+    static bool isCallbackSet(const F &)
+    {
+      return true;
+    }
+    static void callFunction(void *arg)
+    {
+      (*(callback_function_t *)arg)();
+    }
+    static void deleteFunction(void *arg)
+    {
+      delete (callback_function_t *)arg;
+    }
+
+    // Timer clock cache, see getTimerClkFreq()
+    uint32_t _timerClkFreq = 0;
+    uint32_t _timerClkPerUs = 0;
+    uint32_t _usPerTickQ32 = 0;  // microseconds per tick, Q32
+    uint32_t _timerClkEpoch = 0;
+    static volatile uint32_t _clockEpoch;
+
+    uint32_t computeTimerClkFreq();
+    void refreshTimerClk();
+    uint32_t getTimerClkPerUs();
+    uint32_t ticksToMicros(uint32_t ticks);
 };
 
 extern timerObj_t *HardwareTimer_Handle[TIMER_NUM];
@@ -0,0 +1,168 @@
+#include "Arduino.h"
+#include "PolyTone.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+static const uint32_t ocChannels[] = {
+  LL_TIM_CHANNEL_CH1,
+  LL_TIM_CHANNEL_CH2,
+  LL_TIM_CHANNEL_CH3,
+  LL_TIM_CHANNEL_CH4,
+};
+
+bool PolyTone::begin(uint32_t pin, uint32_t sampleRate)
+{
+  end();
+  PinName p = digitalPinToPinName(pin);
+  if ((p == NC) || (sampleRate == 0)) {
+    return false;
+  }
+  TIM_TypeDef* tim = (TIM_TypeDef*)pinmap_peripheral(p, PinMap_TIM);
+  if (tim == NULL) {
+    return false;
+  }
+  uint32_t channel = PY32_PIN_CHANNEL(pinmap_function(p, PinMap_TIM));
+  if ((channel < 1) || (channel > 4)) {
+    return false;
+  }
+
+  // Reuse the timer object if the core already has one for this instance.
+  uint32_t index = get_timer_index(tim);
+  if (index != UNKNOWN_TIMER && HardwareTimer_Handle[index] != NULL && HardwareTimer_Handle[index]->__this != NULL) {
+    timer_ = (HardwareTimer*)HardwareTimer_Handle[index]->__this;
+    ownsTimer_ = false;
+  } else {
+    timer_ = new HardwareTimer(tim);
+    ownsTimer_ = true;
+  }
+
+  // One PWM period per sample; below 64 steps the output is mostly noise.
+  uint32_t ticks = timer_->getTimerClkFreq() / sampleRate;
+  if (ticks < 64) {
+    end();
+    return false;
+  }
+  uint32_t prescaler = ticks / 0x10000 + 1;
+  uint32_t period = ticks / prescaler;
+
+  channel_ = channel;
+  sampleRate_ = timer_->getTimerClkFreq() / (prescaler * period);
+  center_ = period / 2;
+  // Full scale: every voice at +-128 * 255.
+  scale_ = (int32_t)((center_ << 16) / (128UL * 255 * POLYTONE_VOICES));
+  ccr_ = &(&tim->CCR1)[channel - 1];
+
+  timer_->pause();
+  timer_->setPrescaleFactor(prescaler);
+  timer_->setOverflow(period, TICK_FORMAT);
+  timer_->setMode(channel, TIMER_OUTPUT_COMPARE_PWM1, p);
+  timer_->setCaptureCompare(channel, center_, TICK_COMPARE_FORMAT);
+  LL_TIM_OC_EnablePreload(tim, ocChannels[channel - 1]);
+  timer_->attachInterrupt(sampleCallback, this);
+  timer_->resume();
+  return true;
+}
+
+void PolyTone::end()
+{
+  if (timer_ == nullptr) {
+    return;
+  }
+  timer_->pause();
+  timer_->detachInterrupt();
+  timer_->setMode(channel_, TIMER_OUTPUT_COMPARE_FORCED_INACTIVE);
+  if (ownsTimer_) {
+    delete timer_;
+  }
+  timer_ = nullptr;
+  ownsTimer_ = false;
+  ccr_ = nullptr;
+  for (uint8_t i = 0; i < POLYTONE_VOICES; i++) {
+    voices_[i].active = false;
+  }
+}
+
+void PolyTone::play(uint8_t voice, uint32_t frequency, uint32_t duration, uint8_t volume, PolyToneWave wave)
+{
+  if ((voice >= POLYTONE_VOICES) || (sampleRate_ == 0)) {
+    return;
+  }
+  if ((frequency == 0) || (frequency >= sampleRate_ / 2)) {
+    stop(voice);
+    return;
+  }
+  uint32_t step = (uint32_t)(((uint64_t)frequency << 32) / sampleRate_);
+  uint32_t samples = (uint32_t)(((uint64_t)duration * sampleRate_ + 999) / 1000);
+  Voice& v = voices_[voice];
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (!v.active) {
+    v.phase = 0;
+  }
+  v.step = step;
+  v.remaining = samples;
+  v.timed = (duration != 0);
+  v.volume = volume;
+  v.wave = wave;
+  v.active = true;
+  __set_PRIMASK(primask);
+}
+
+void PolyTone::stop(uint8_t voice)
+{
+  if (voice < POLYTONE_VOICES) {
+    voices_[voice].active = false;
+  }
+}
+
+void PolyTone::stopAll()
+{
+  for (uint8_t i = 0; i < POLYTONE_VOICES; i++) {
+    voices_[i].active = false;
+  }
+}
+
+bool PolyTone::playing(uint8_t voice) const
+{
+  return (voice < POLYTONE_VOICES) && voices_[voice].active;
+}
+
+void PolyTone::sampleCallback(void* self)
+{
+  ((PolyTone*)self)->render();
+}
+
+void PolyTone::render()
+{
+  int32_t mix = 0;
+
+  for (uint8_t i = 0; i < POLYTONE_VOICES; i++) {
+    Voice& v = voices_[i];
+    if (!v.active) {
+      continue;
+    }
+    v.phase += v.step;
+    int32_t top = (int32_t)(v.phase >> 24);
+    int32_t sample;
+    switch (v.wave) {
+      case POLYTONE_TRIANGLE:
+        sample = (top < 128) ? (2 * top - 128) : (383 - 2 * top);
+        break;
+      case POLYTONE_SAWTOOTH:
+        sample = top - 128;
+        break;
+      default:
+        sample = (top < 128) ? 127 : -128;
+        break;
+    }
+    mix += sample * v.volume;
+    if (v.timed && (--v.remaining == 0)) {
+      v.active = false;
+    }
+  }
+  // Arithmetic shift: rounds towards minus infinity, one step at most.
+  *ccr_ = (uint32_t)((int32_t)center_ + ((mix * scale_) >> 16));
+}
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+#include "HardwareTimer.h"
+
+// Number of voices mixed. Each one costs about 20 cycles per sample.
+#ifndef POLYTONE_VOICES
+#define POLYTONE_VOICES 4
+#endif
+
+enum PolyToneWave : uint8_t {
+  POLYTONE_SQUARE,
+  POLYTONE_TRIANGLE,
+  POLYTONE_SAWTOOTH,
+};
+
+// Several tones at once on one PWM pin.
+//
+// Each voice is a direct digital synthesis oscillator: a 32-bit phase
+// accumulator advanced by frequency * 2^32 / sampleRate per sample, whose
+// top bits give the waveform. The update interrupt of the pin's timer runs
+// once per PWM period, at the sample rate, sums the voices and writes the
+// next duty (preloaded, so it starts with the following period). Integer
+// math only.
+//
+// The PWM carrier is the sample rate: low-pass filter the pin (e.g. 1 kOhm
+// and 100 nF) for a speaker, a piezo filters it by itself.
+class PolyTone {
+public:
+  // pin: a timer channel pin. The interrupt load grows with the sample rate:
+  // roughly 15% of a 24 MHz CPU at 16 kHz with 4 voices.
+  bool begin(uint32_t pin, uint32_t sampleRate = 16000);
+  void end();
+
+  // Start voice 0..POLYTONE_VOICES-1 at frequency Hz (below half the sample
+  // rate) for duration ms, 0 until stop(). volume 0..255.
+  void play(uint8_t voice, uint32_t frequency, uint32_t duration = 0,
+            uint8_t volume = 255, PolyToneWave wave = POLYTONE_SQUARE);
+  void stop(uint8_t voice);
+  void stopAll();
+  bool playing(uint8_t voice) const;
+
+  // Actual sample rate, in Hz.
+  uint32_t sampleRate() const { return sampleRate_; }
+
+private:
+  struct Voice {
+    uint32_t phase;
+    uint32_t step;
+    uint32_t remaining;  // samples left, if timed
+    uint8_t volume;
+    uint8_t wave;
+    bool timed;
+    volatile bool active;
+  };
+
+  static void sampleCallback(void* self);
+  void render();
+
+  HardwareTimer* timer_ = nullptr;
+  bool ownsTimer_ = false;
+  uint32_t channel_ = 0;
+  volatile uint32_t* ccr_ = nullptr;
+  uint32_t center_ = 0;
+  int32_t scale_ = 0;  // mix to duty, Q16
+  uint32_t sampleRate_ = 0;
+  Voice voices_[POLYTONE_VOICES] = {};
+};
+
+#endif
@@ -0,0 +1,274 @@
+#include "Arduino.h"
+#include "PulseCapture.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+#include "HardwareTimer.h"
+
+bool PulseCapture::begin(uint32_t pin, uint32_t tickHz, uint8_t averaging)
+{
+  end();
+  if ((averaging == 0) || ((averaging & (averaging - 1)) != 0)) {
+    return false;
+  }
+
+  PinName p = digitalPinToPinName(pin);
+  TIM_TypeDef* tim = (TIM_TypeDef*)pinmap_peripheral(p, PinMap_TIM);
+  if ((tim == NULL) || !IS_TIM_SLAVE_INSTANCE(tim)) {
+    return false;
+  }
+  uint32_t function = pinmap_function(p, PinMap_TIM);
+  uint32_t channel = PY32_PIN_CHANNEL(function);
+  if (((channel != 1) && (channel != 2)) || PY32_PIN_INVERTED(function)) {
+    return false;
+  }
+
+  // Reuse the timer object if the core already has one for this instance.
+  uint32_t index = get_timer_index(tim);
+  if (index != UNKNOWN_TIMER && HardwareTimer_Handle[index] != NULL && HardwareTimer_Handle[index]->__this != NULL) {
+    timer_ = (HardwareTimer*)HardwareTimer_Handle[index]->__this;
+    ownsTimer_ = false;
+  } else {
+    timer_ = new HardwareTimer(tim);
+    ownsTimer_ = true;
+  }
+
+  uint32_t clock = timer_->getTimerClkFreq();
+  uint32_t prescaler = (tickHz != 0) ? (clock + tickHz / 2) / tickHz : 1;
+  if (prescaler == 0) {
+    prescaler = 1;
+  }
+  if (prescaler > 0x10000) {
+    end();
+    return false;
+  }
+  tickRate_ = clock / prescaler;
+
+  instance_ = tim;
+  channel_ = channel;
+  periodCCR_ = (channel == 1) ? &tim->CCR1 : &tim->CCR2;
+  highCCR_ = (channel == 1) ? &tim->CCR2 : &tim->CCR1;
+  fallingIE_ = (channel == 1) ? TIM_DIER_CC2IE : TIM_DIER_CC1IE;
+
+  averaging_ = averaging;
+  averagingShift_ = 0;
+  while ((1U << averagingShift_) < averaging) {
+    averagingShift_++;
+  }
+  setTimeout(timeoutMs_);
+
+  overflows_ = 0;
+  highOverflows_ = 0;
+  synced_ = false;
+  longPeriods_ = false;
+  count_ = 0;
+  periodAcc_ = 0;
+  highAcc_ = 0;
+  periodSum_ = 0;
+  highSum_ = 0;
+  available_ = false;
+
+  timer_->pause();
+  timer_->setPrescaleFactor(prescaler);
+  LL_TIM_SetAutoReload(tim, 0xFFFF);
+  timer_->setMode(channel, TIMER_INPUT_FREQ_DUTY_MEASUREMENT, p);
+
+  // Each rising edge restarts the counter: the direct capture is then the
+  // period and the paired capture the high time. Only overflows raise the
+  // update interrupt, not these resets.
+  LL_TIM_SetTriggerInput(tim, (channel == 1) ? LL_TIM_TS_TI1FP1 : LL_TIM_TS_TI2FP2);
+  LL_TIM_SetSlaveMode(tim, LL_TIM_SLAVEMODE_RESET);
+  LL_TIM_SetUpdateSource(tim, LL_TIM_UPDATESOURCE_COUNTER);
+
+  timer_->attachInterrupt(overflowCallback, this);
+  timer_->attachInterrupt(channel, captureCallback, this);
+  timer_->attachInterrupt(3 - channel, fallingCallback, this);
+  timer_->resume();
+  // The falling edge interrupt is only needed for periods over 16 bits.
+  tim->DIER &= ~fallingIE_;
+  return true;
+}
+
+void PulseCapture::end()
+{
+  if (timer_ != nullptr) {
+    timer_->pause();
+    timer_->detachInterrupt();
+    timer_->detachInterrupt(channel_);
+    timer_->detachInterrupt(3 - channel_);
+    LL_TIM_SetSlaveMode(instance_, LL_TIM_SLAVEMODE_DISABLED);
+    LL_TIM_SetUpdateSource(instance_, LL_TIM_UPDATESOURCE_REGULAR);
+    if (ownsTimer_) {
+      delete timer_;
+    }
+    timer_ = nullptr;
+    ownsTimer_ = false;
+  }
+  instance_ = nullptr;
+  available_ = false;
+  periodSum_ = 0;
+  highSum_ = 0;
+}
+
+void PulseCapture::setTimeout(uint32_t ms)
+{
+  uint64_t overflows = (((uint64_t)ms * tickRate_ / 1000) >> 16) + 1;
+
+  timeoutMs_ = ms;
+  // Keeps period ticks within 32 bits.
+  timeoutOverflows_ = (overflows > 0xFFFF) ? 0xFFFF : (uint32_t)overflows;
+}
+
+void PulseCapture::handleCapture()
+{
+  uint32_t period = *periodCCR_;
+  uint32_t high = *highCCR_;
+  uint32_t over = overflows_;
+
+  // An overflow just before the edge is still pending behind this capture.
+  if (LL_TIM_IsActiveFlag_UPDATE(instance_) && (period < 0x8000)) {
+    LL_TIM_ClearFlag_UPDATE(instance_);
+    over++;
+  }
+  overflows_ = 0;
+
+  if (!synced_) {
+    // First edge: the counter had not been restarted by an edge before.
+    synced_ = true;
+    return;
+  }
+
+  if (over != 0) {
+    if (!longPeriods_) {
+      // The high time may span overflows too: count them at the falling
+      // edge from now on. This period's high time is ambiguous, drop it.
+      longPeriods_ = true;
+      highOverflows_ = 0;
+      instance_->DIER |= fallingIE_;
+      return;
+    }
+    period += over << 16;
+    high += highOverflows_ << 16;
+    highOverflows_ = 0;
+  } else if (longPeriods_) {
+    longPeriods_ = false;
+    instance_->DIER &= ~fallingIE_;
+  }
+
+  periodAcc_ += period;
+  highAcc_ += high;
+  if (++count_ >= averaging_) {
+    publish(periodAcc_, highAcc_);
+    count_ = 0;
+    periodAcc_ = 0;
+    highAcc_ = 0;
+  }
+}
+
+void PulseCapture::handleFalling()
+{
+  uint32_t over = overflows_;
+
+  if (LL_TIM_IsActiveFlag_UPDATE(instance_) && (*highCCR_ < 0x8000)) {
+    over++;
+  }
+  highOverflows_ = over;
+}
+
+void PulseCapture::handleOverflow()
+{
+  if (++overflows_ < timeoutOverflows_) {
+    return;
+  }
+  overflows_ = 0;
+  if (synced_) {
+    synced_ = false;
+    count_ = 0;
+    periodAcc_ = 0;
+    highAcc_ = 0;
+    publish(0, 0);
+  }
+}
+
+void PulseCapture::publish(uint64_t periodSum, uint64_t highSum)
+{
+  periodSum_ = periodSum;
+  highSum_ = highSum;
+  available_ = true;
+  if (callback_ != nullptr) {
+    callback_((uint32_t)(periodSum >> averagingShift_), (uint32_t)(highSum >> averagingShift_));
+  }
+}
+
+void PulseCapture::snapshot(uint64_t* periodSum, uint64_t* highSum)
+{
+  noInterrupts();
+  *periodSum = periodSum_;
+  *highSum = highSum_;
+  interrupts();
+}
+
+bool PulseCapture::read(uint32_t* periodTicks, uint32_t* highTicks)
+{
+  uint64_t periodSum, highSum;
+
+  if (!available_) {
+    return false;
+  }
+  snapshot(&periodSum, &highSum);
+  available_ = false;
+  if (periodTicks != nullptr) {
+    *periodTicks = (uint32_t)(periodSum >> averagingShift_);
+  }
+  if (highTicks != nullptr) {
+    *highTicks = (uint32_t)(highSum >> averagingShift_);
+  }
+  return true;
+}
+
+uint32_t PulseCapture::frequencyMilliHz()
+{
+  uint64_t periodSum, highSum;
+
+  snapshot(&periodSum, &highSum);
+  if (periodSum == 0) {
+    return 0;
+  }
+  // The sum covers averaging_ periods: no precision lost to the average.
+  return (uint32_t)(((uint64_t)tickRate_ * 1000 * averaging_ + periodSum / 2) / periodSum);
+}
+
+uint32_t PulseCapture::periodMicros()
+{
+  uint64_t periodSum, highSum;
+
+  snapshot(&periodSum, &highSum);
+  if (tickRate_ == 0) {
+    return 0;
+  }
+  return (uint32_t)(((periodSum * 1000000) / tickRate_) >> averagingShift_);
+}
+
+uint32_t PulseCapture::highMicros()
+{
+  uint64_t periodSum, highSum;
+
+  snapshot(&periodSum, &highSum);
+  if (tickRate_ == 0) {
+    return 0;
+  }
+  return (uint32_t)(((highSum * 1000000) / tickRate_) >> averagingShift_);
+}
+
+uint16_t PulseCapture::dutyCentiPercent()
+{
+  uint64_t periodSum, highSum;
+
+  snapshot(&periodSum, &highSum);
+  if (periodSum == 0) {
+    return 0;
+  }
+  return (uint16_t)((highSum * 10000) / periodSum);
+}
+
+#endif
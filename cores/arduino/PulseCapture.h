@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+// Period and high time of a digital signal, measured by timer hardware.
+//
+// The pin's timer channel runs in PWM-input mode: its direct capture latches
+// the counter on each rising edge, the paired channel latches it on the
+// falling edge, and the rising edge also resets the counter (slave reset
+// mode). Each period the capture registers hold the period and the high time
+// directly, with timer-clock resolution and no CPU work between edges. Update
+// events extend the 16-bit counter for periods longer than 65536 ticks.
+//
+// One interrupt per signal period hands the result to onResult(); averaging
+// over 2..128 periods lowers the result rate and the jitter. The pin must be
+// on channel 1 or 2 of a timer with a slave mode controller (TIM1, TIM3).
+class PulseCapture {
+public:
+  // Called from the timer interrupt with the (averaged) period and high time
+  // in ticks, or with zeros when the signal stops (timeout).
+  typedef void (*ResultCallback)(uint32_t periodTicks, uint32_t highTicks);
+
+  // tickHz: counting rate, 0 for the full timer clock. Lower rates measure
+  // longer periods per counter overflow but with a coarser resolution.
+  // averaging: periods per result, 1, 2, 4 .. 128.
+  bool begin(uint32_t pin, uint32_t tickHz = 0, uint8_t averaging = 1);
+  void end();
+
+  // Report "no signal" when no rising edge comes for ms milliseconds.
+  void setTimeout(uint32_t ms);
+
+  // True once a result is waiting; read() clears it.
+  bool available() const { return available_; }
+  // Latest result in ticks; false if none since the last read().
+  bool read(uint32_t* periodTicks, uint32_t* highTicks);
+
+  // Latest result converted; 0 when there is no signal.
+  uint32_t frequencyMilliHz();
+  uint32_t periodMicros();
+  uint32_t highMicros();
+  uint16_t dutyCentiPercent();   // 0..10000
+
+  // Actual counting rate.
+  uint32_t tickRate() const { return tickRate_; }
+
+  void onResult(ResultCallback callback) { callback_ = callback; }
+
+private:
+  static void captureCallback(void* self) { ((PulseCapture*)self)->handleCapture(); }
+  static void fallingCallback(void* self) { ((PulseCapture*)self)->handleFalling(); }
+  static void overflowCallback(void* self) { ((PulseCapture*)self)->handleOverflow(); }
+  void handleCapture();
+  void handleFalling();
+  void handleOverflow();
+  void publish(uint64_t periodSum, uint64_t highSum);
+  void snapshot(uint64_t* periodSum, uint64_t* highSum);
+
+  HardwareTimer* timer_ = nullptr;
+  bool ownsTimer_ = false;
+  TIM_TypeDef* instance_ = nullptr;
+  volatile uint32_t* periodCCR_ = nullptr;
+  volatile uint32_t* highCCR_ = nullptr;
+  uint32_t fallingIE_ = 0;
+  uint8_t channel_ = 0;
+
+  uint32_t tickRate_ = 0;
+  uint32_t timeoutMs_ = 1000;
+  uint32_t timeoutOverflows_ = 0;
+
+  volatile uint32_t overflows_ = 0;
+  uint32_t highOverflows_ = 0;
+  bool synced_ = false;
+  bool longPeriods_ = false;
+
+  uint8_t averaging_ = 1;
+  uint8_t averagingShift_ = 0;
+  uint8_t count_ = 0;
+  uint64_t periodAcc_ = 0;
+  uint64_t highAcc_ = 0;
+
+  uint64_t periodSum_ = 0;
+  uint64_t highSum_ = 0;
+  volatile bool available_ = false;
+  ResultCallback callback_ = nullptr;
+};
+
+// Same engine, named after its most common use.
+typedef PulseCapture FrequencyMeter;
+
+#endif
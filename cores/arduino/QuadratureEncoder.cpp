@@ -0,0 +1,200 @@
+#include "Arduino.h"
+#include "QuadratureEncoder.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+#include "HardwareTimer.h"
+
+static const uint32_t encoderModes[] = {
+  LL_TIM_ENCODERMODE_X2_TI1,
+  LL_TIM_ENCODERMODE_X2_TI2,
+  LL_TIM_ENCODERMODE_X4_TI12,
+};
+
+bool QuadratureEncoder::begin(uint32_t pinA, uint32_t pinB, EncoderMode_t mode, uint8_t filter)
+{
+  end();
+  if (((uint32_t)mode > ENCODER_X4) || (filter > 15)) {
+    return false;
+  }
+
+  PinName a = digitalPinToPinName(pinA);
+  PinName b = digitalPinToPinName(pinB);
+  TIM_TypeDef* tim = (TIM_TypeDef*)pinmap_peripheral(a, PinMap_TIM);
+  if ((tim == NULL) || !IS_TIM_SLAVE_INSTANCE(tim) ||
+      (tim != (TIM_TypeDef*)pinmap_peripheral(b, PinMap_TIM))) {
+    return false;
+  }
+  uint32_t functionA = pinmap_function(a, PinMap_TIM);
+  uint32_t functionB = pinmap_function(b, PinMap_TIM);
+  if ((PY32_PIN_CHANNEL(functionA) != 1) || PY32_PIN_INVERTED(functionA) ||
+      (PY32_PIN_CHANNEL(functionB) != 2) || PY32_PIN_INVERTED(functionB)) {
+    return false;
+  }
+
+  // Reuse the timer object if the core already has one for this instance.
+  uint32_t index = get_timer_index(tim);
+  if (index != UNKNOWN_TIMER && HardwareTimer_Handle[index] != NULL && HardwareTimer_Handle[index]->__this != NULL) {
+    timer_ = (HardwareTimer*)HardwareTimer_Handle[index]->__this;
+    ownsTimer_ = false;
+  } else {
+    timer_ = new HardwareTimer(tim);
+    ownsTimer_ = true;
+  }
+  instance_ = tim;
+
+  timer_->pause();
+  timer_->setPrescaleFactor(1);
+  LL_TIM_SetAutoReload(tim, 0xFFFF);
+  pinmap_pinout(a, PinMap_TIM);
+  pinmap_pinout(b, PinMap_TIM);
+
+  uint32_t icFilter = ((uint32_t)filter << TIM_CCMR1_IC1F_Pos) << 16U;
+  LL_TIM_IC_SetActiveInput(tim, LL_TIM_CHANNEL_CH1, LL_TIM_ACTIVEINPUT_DIRECTTI);
+  LL_TIM_IC_SetActiveInput(tim, LL_TIM_CHANNEL_CH2, LL_TIM_ACTIVEINPUT_DIRECTTI);
+  LL_TIM_IC_SetFilter(tim, LL_TIM_CHANNEL_CH1, icFilter);
+  LL_TIM_IC_SetFilter(tim, LL_TIM_CHANNEL_CH2, icFilter);
+  LL_TIM_IC_SetPolarity(tim, LL_TIM_CHANNEL_CH1, LL_TIM_IC_POLARITY_RISING);
+  LL_TIM_IC_SetPolarity(tim, LL_TIM_CHANNEL_CH2, LL_TIM_IC_POLARITY_RISING);
+  LL_TIM_SetEncoderMode(tim, encoderModes[mode]);
+  LL_TIM_CC_EnableChannel(tim, LL_TIM_CHANNEL_CH1 | LL_TIM_CHANNEL_CH2);
+  // Only counter wraps raise the update interrupt.
+  LL_TIM_SetUpdateSource(tim, LL_TIM_UPDATESOURCE_COUNTER);
+  LL_TIM_SetCounter(tim, 0);
+
+  high_ = 0;
+  indexShift_ = 0;
+  velocityTime_ = micros();
+  velocityPosition_ = 0;
+  velocity_ = 0;
+
+  timer_->attachInterrupt(overflowCallback, this);
+  timer_->resume();
+  return true;
+}
+
+void QuadratureEncoder::end()
+{
+  detachIndex();
+  if (timer_ != nullptr) {
+    timer_->pause();
+    timer_->detachInterrupt();
+    LL_TIM_SetSlaveMode(instance_, LL_TIM_SLAVEMODE_DISABLED);
+    LL_TIM_CC_DisableChannel(instance_, LL_TIM_CHANNEL_CH1 | LL_TIM_CHANNEL_CH2);
+    LL_TIM_SetUpdateSource(instance_, LL_TIM_UPDATESOURCE_REGULAR);
+    if (ownsTimer_) {
+      delete timer_;
+    }
+    timer_ = nullptr;
+    ownsTimer_ = false;
+  }
+  instance_ = nullptr;
+}
+
+void QuadratureEncoder::attachIndex(uint32_t pin, uint32_t edge)
+{
+  detachIndex();
+  if (instance_ == nullptr) {
+    return;
+  }
+  indexPin_ = pin;
+  pinMode(pin, INPUT);
+  attachInterruptArg(pin, indexCallback, this, edge);
+}
+
+void QuadratureEncoder::detachIndex()
+{
+  if (indexPin_ != NUM_DIGITAL_PINS) {
+    detachInterrupt(indexPin_);
+    indexPin_ = NUM_DIGITAL_PINS;
+  }
+}
+
+// Call with interrupts disabled.
+int64_t QuadratureEncoder::position64() const
+{
+  uint32_t count = LL_TIM_GetCounter(instance_);
+  int64_t high = high_;
+
+  // Wrapped, but the update interrupt has not run yet.
+  if (LL_TIM_IsActiveFlag_UPDATE(instance_)) {
+    high += (count < 0x8000) ? 0x10000 : -0x10000;
+  }
+  return high + count;
+}
+
+int64_t QuadratureEncoder::read64()
+{
+  int64_t position;
+
+  if (instance_ == nullptr) {
+    return 0;
+  }
+  noInterrupts();
+  position = position64();
+  interrupts();
+  return position;
+}
+
+int32_t QuadratureEncoder::read()
+{
+  return (int32_t)read64();
+}
+
+void QuadratureEncoder::write(int64_t position)
+{
+  if (instance_ == nullptr) {
+    return;
+  }
+  noInterrupts();
+  indexShift_ += position64() - position;
+  LL_TIM_SetCounter(instance_, (uint32_t)position & 0xFFFF);
+  LL_TIM_ClearFlag_UPDATE(instance_);
+  high_ = position - (int64_t)((uint32_t)position & 0xFFFF);
+  interrupts();
+}
+
+void QuadratureEncoder::handleOverflow()
+{
+  // Just wrapped: the counter is near 0 after counting up, near 0xFFFF
+  // after counting down.
+  if (LL_TIM_GetCounter(instance_) < 0x8000) {
+    high_ += 0x10000;
+  } else {
+    high_ -= 0x10000;
+  }
+}
+
+void QuadratureEncoder::handleIndex()
+{
+  indexShift_ += position64();
+  LL_TIM_SetCounter(instance_, 0);
+  LL_TIM_ClearFlag_UPDATE(instance_);
+  high_ = 0;
+}
+
+void QuadratureEncoder::setVelocityWindow(uint32_t windowMs)
+{
+  velocityWindowUs_ = windowMs * 1000;
+}
+
+int32_t QuadratureEncoder::velocity()
+{
+  uint32_t now = micros();
+  uint32_t elapsed = now - velocityTime_;
+  int64_t position;
+
+  if ((instance_ == nullptr) || (elapsed < velocityWindowUs_) || (elapsed == 0)) {
+    return velocity_;
+  }
+  noInterrupts();
+  position = position64() + indexShift_;
+  interrupts();
+
+  velocity_ = (int32_t)(((position - velocityPosition_) * 1000000) / elapsed);
+  velocityPosition_ = position;
+  velocityTime_ = now;
+  return velocity_;
+}
+
+#endif
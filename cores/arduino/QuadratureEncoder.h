@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+// Counting modes of the timer encoder interface.
+typedef enum {
+  ENCODER_X2_TI1,  // count on A edges only
+  ENCODER_X2_TI2,  // count on B edges only
+  ENCODER_X4,      // count on every edge of A and B
+} EncoderMode_t;
+
+// Quadrature encoder counted by timer hardware.
+//
+// A and B go to channels 1 and 2 of one timer in encoder mode: the counter
+// follows every edge without any interrupt. The update interrupt, raised only
+// when the 16-bit counter wraps (every 65536 counts), extends the position
+// to 64 bits. An optional index pin resets the position through an EXTI
+// interrupt, once per revolution. velocity() samples the position at most
+// once per window, so speed tracking costs nothing per edge either.
+class QuadratureEncoder {
+public:
+  // pinA: channel 1, pinB: channel 2 of the same timer (TIM1, TIM3).
+  // filter: input filter 0..15 (0 = off), rejects glitches shorter than a
+  // few timer clocks.
+  bool begin(uint32_t pinA, uint32_t pinB, EncoderMode_t mode = ENCODER_X4, uint8_t filter = 0);
+  void end();
+
+  // Reset the position to zero on each `edge` (RISING/FALLING) of pin.
+  void attachIndex(uint32_t pin, uint32_t edge = RISING);
+  void detachIndex();
+
+  int32_t read();
+  int64_t read64();
+  void write(int64_t position);
+
+  // Counts per second, measured over at least windowMs (default 100 ms).
+  int32_t velocity();
+  void setVelocityWindow(uint32_t windowMs);
+
+private:
+  static void overflowCallback(void* self) { ((QuadratureEncoder*)self)->handleOverflow(); }
+  static void indexCallback(void* self) { ((QuadratureEncoder*)self)->handleIndex(); }
+  void handleOverflow();
+  void handleIndex();
+  int64_t position64() const;
+
+  HardwareTimer* timer_ = nullptr;
+  bool ownsTimer_ = false;
+  TIM_TypeDef* instance_ = nullptr;
+  uint32_t indexPin_ = NUM_DIGITAL_PINS;
+
+  volatile int64_t high_ = 0;
+  // Sum of the positions dropped by index resets: keeps velocity continuous.
+  volatile int64_t indexShift_ = 0;
+
+  uint32_t velocityWindowUs_ = 100000;
+  uint32_t velocityTime_ = 0;
+  int64_t velocityPosition_ = 0;
+  int32_t velocity_ = 0;
+};
+
+#endif
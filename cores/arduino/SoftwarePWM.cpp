@@ -0,0 +1,292 @@
+#include "Arduino.h"
+#include "SoftwarePWM.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+#include "HardwareTimer.h"
+
+SoftwarePWM* SoftwarePWM::s_active = nullptr;
+
+bool SoftwarePWM::begin(TIM_TypeDef* timer, uint32_t frequencyHz, uint16_t resolution)
+{
+  end();
+  // Steps are at least 2 ticks long, see build()
+  if ((timer == nullptr) || (frequencyHz == 0) || (resolution < 4) || (s_active != nullptr)) {
+    return false;
+  }
+
+  // Reuse the timer object if the core already has one for this instance.
+  uint32_t index = get_timer_index(timer);
+  if (index != UNKNOWN_TIMER && HardwareTimer_Handle[index] != NULL && HardwareTimer_Handle[index]->__this != NULL) {
+    timer_ = (HardwareTimer*)HardwareTimer_Handle[index]->__this;
+    ownsTimer_ = false;
+  } else {
+    timer_ = new HardwareTimer(timer);
+    ownsTimer_ = true;
+  }
+
+  uint64_t tickRate = (uint64_t)frequencyHz * resolution;
+  uint64_t prescaler = ((uint64_t)timer_->getTimerClkFreq() + tickRate / 2) / tickRate;
+  if ((prescaler == 0) || (prescaler > 0x10000)) {
+    end();
+    return false;
+  }
+  resolution_ = resolution;
+
+  timer_->pause();
+  timer_->setPrescaleFactor((uint32_t)prescaler);
+  timer_->setPreloadEnable(true);
+
+  Schedule& s = schedules_[0];
+  build(s);
+  active_ = 0;
+  pending_ = false;
+
+  // Load the first step, then preload the second: from here on the interrupt
+  // at each edge preloads the length of the step after the one starting.
+  LL_TIM_SetAutoReload(timer, s.steps[0].reload);
+  LL_TIM_GenerateEvent_UPDATE(timer);
+  LL_TIM_ClearFlag_UPDATE(timer);
+  step_ = (s.count > 1) ? 1 : 0;
+  LL_TIM_SetAutoReload(timer, s.steps[step_].reload);
+  for (uint8_t p = 0; p < MAX_NB_PORT; p++) {
+    if (s.start[p] != 0) {
+      GPIOPort[p]->BSRR = s.start[p];
+    }
+  }
+
+  s_active = this;
+  timer_->attachInterrupt(_handleUpdate);
+  running_ = true;
+  timer_->resume();
+  return true;
+}
+
+void SoftwarePWM::end()
+{
+  if (running_) {
+    running_ = false;
+    timer_->pause();
+    timer_->detachInterrupt();
+    timer_->setPreloadEnable(false);
+    for (uint8_t i = 0; i < count_; i++) {
+      digitalWriteFast(pins_[i], LOW);
+    }
+  }
+  if (s_active == this) {
+    s_active = nullptr;
+  }
+  if (timer_ != nullptr) {
+    if (ownsTimer_) {
+      delete timer_;
+    }
+    timer_ = nullptr;
+    ownsTimer_ = false;
+  }
+  pending_ = false;
+}
+
+int SoftwarePWM::indexOf(PinName pin) const
+{
+  for (uint8_t i = 0; i < count_; i++) {
+    if (pins_[i] == pin) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool SoftwarePWM::attach(uint32_t pin, uint16_t duty)
+{
+  PinName p = digitalPinToPinName(pin);
+
+  if (p == NC) {
+    return false;
+  }
+  if (indexOf(p) < 0) {
+    if (count_ >= SOFTWARE_PWM_CHANNELS) {
+      return false;
+    }
+    pinMode(pin, OUTPUT);
+    digitalWriteFast(p, LOW);
+    pins_[count_] = p;
+    duties_[count_] = 0;
+    count_++;
+  }
+  write(pin, duty);
+  return true;
+}
+
+void SoftwarePWM::detach(uint32_t pin)
+{
+  PinName p = digitalPinToPinName(pin);
+  int i = indexOf(p);
+
+  if (i < 0) {
+    return;
+  }
+  count_--;
+  pins_[i] = pins_[count_];
+  duties_[i] = duties_[count_];
+  update();
+  // The pin stays in the running schedule until the end of the period: wait
+  // for the swap, at most two periods. The timer interrupt cannot run when
+  // detach() is called with it masked (e.g. from a higher priority ISR); the
+  // pin may then be set once more by the old schedule.
+  if (running_) {
+    uint32_t periodUs = (uint32_t)(((uint64_t)timer_->getPrescaleFactor() * resolution_ * 1000000) /
+                                   timer_->getTimerClkFreq()) + 1;
+    uint32_t start = micros();
+    while (pending_ && ((uint32_t)(micros() - start) < 2 * periodUs)) {
+    }
+  }
+  digitalWriteFast(p, LOW);
+}
+
+void SoftwarePWM::set(uint32_t pin, uint16_t duty)
+{
+  int i = indexOf(digitalPinToPinName(pin));
+
+  if (i >= 0) {
+    duties_[i] = (duty > resolution_) ? resolution_ : duty;
+  }
+}
+
+void SoftwarePWM::write(uint32_t pin, uint16_t duty)
+{
+  set(pin, duty);
+  update();
+}
+
+uint16_t SoftwarePWM::read(uint32_t pin) const
+{
+  int i = indexOf(digitalPinToPinName(pin));
+  return (i >= 0) ? duties_[i] : 0;
+}
+
+void SoftwarePWM::update()
+{
+  if (!running_) {
+    // begin() builds from the current duties.
+    return;
+  }
+  // The interrupt only swaps buffers while pending_ is set: once cleared,
+  // the inactive buffer is ours until pending_ is set again.
+  pending_ = false;
+  build(schedules_[active_ ^ 1]);
+  pending_ = true;
+}
+
+void SoftwarePWM::build(Schedule& s)
+{
+  uint8_t order[SOFTWARE_PWM_CHANNELS];
+  uint8_t sorted = 0;
+
+  for (uint8_t p = 0; p < MAX_NB_PORT; p++) {
+    s.start[p] = 0;
+  }
+
+  // Start word per port, and insertion sort of the channels that go low
+  // inside the period (0 < duty < resolution).
+  for (uint8_t i = 0; i < count_; i++) {
+    uint32_t port = PY32_PORT(pins_[i]);
+    uint32_t mask = PY32_LL_GPIO_PIN(pins_[i]);
+    uint16_t duty = duties_[i];
+
+    if (duty == 0) {
+      s.start[port] |= mask << 16;
+      continue;
+    }
+    s.start[port] |= mask;
+    if (duty >= resolution_) {
+      continue;
+    }
+    uint8_t j = sorted++;
+    while ((j > 0) && (duties_[order[j - 1]] > duty)) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+
+  // One step per distinct edge time; step 0 is the period start. A step of
+  // one tick would need ARR = 0, which stops the counter and with it the
+  // whole step chain: every step lasts at least MIN_STEP ticks. Edges are
+  // kept within [MIN_STEP, resolution - MIN_STEP] (duty 1 ends at 2, duty
+  // resolution - 1 at resolution - 2), and an edge closer than MIN_STEP to
+  // the previous one is merged into it.
+  const uint16_t MIN_STEP = 2;
+  uint8_t count = 1;
+  uint16_t time = 0;
+  for (uint8_t p = 0; p < MAX_NB_PORT; p++) {
+    s.steps[0].reset[p] = 0;
+  }
+  for (uint8_t j = 0; j < sorted; j++) {
+    uint8_t i = order[j];
+    uint16_t duty = duties_[i];
+
+    if (duty < MIN_STEP) {
+      duty = MIN_STEP;
+    } else if (duty > resolution_ - MIN_STEP) {
+      duty = resolution_ - MIN_STEP;
+    }
+    if (duty - time >= MIN_STEP) {
+      s.steps[count - 1].reload = duty - time - 1;
+      for (uint8_t p = 0; p < MAX_NB_PORT; p++) {
+        s.steps[count].reset[p] = 0;
+      }
+      count++;
+      time = duty;
+    }
+    s.steps[count - 1].reset[PY32_PORT(pins_[i])] |= (uint16_t)PY32_LL_GPIO_PIN(pins_[i]);
+  }
+  s.steps[count - 1].reload = resolution_ - time - 1;
+  s.count = count;
+}
+
+uint32_t SoftwarePWM::frequency()
+{
+  if (timer_ == nullptr) {
+    return 0;
+  }
+  return timer_->getTimerClkFreq() / (timer_->getPrescaleFactor() * resolution_);
+}
+
+void SoftwarePWM::_handleUpdate()
+{
+  SoftwarePWM* self = s_active;
+  if (self == nullptr) {
+    return;
+  }
+
+  const Schedule* s = &self->schedules_[self->active_];
+  uint8_t i = self->step_;
+
+  if (i == 0) {
+    for (uint8_t p = 0; p < MAX_NB_PORT; p++) {
+      if (s->start[p] != 0) {
+        GPIOPort[p]->BSRR = s->start[p];
+      }
+    }
+  } else {
+    for (uint8_t p = 0; p < MAX_NB_PORT; p++) {
+      if (s->steps[i].reset[p] != 0) {
+        GPIOPort[p]->BSRR = (uint32_t)s->steps[i].reset[p] << 16;
+      }
+    }
+  }
+
+  // The auto-reload just loaded is this step's; preload the next one.
+  if (++i >= s->count) {
+    i = 0;
+    if (self->pending_) {
+      self->active_ ^= 1;
+      self->pending_ = false;
+      s = &self->schedules_[self->active_];
+    }
+  }
+  self->timer_->getHandle()->Instance->ARR = s->steps[i].reload;
+  self->step_ = i;
+}
+
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+// Maximum number of pins driven by one SoftwarePWM. Each channel costs one
+// edge slot in both schedule buffers; lower it to save RAM.
+#ifndef SOFTWARE_PWM_CHANNELS
+#define SOFTWARE_PWM_CHANNELS 16
+#endif
+
+// PWM on any GPIO, driven by one HardwareTimer.
+//
+// All channels share the same frequency and resolution. Every period starts
+// with all non-zero channels set high; each channel is then reset at the tick
+// given by its duty. The schedule is a list of the distinct edge times,
+// sorted, with the GPIO BSRR words to write at each: pins switching at the
+// same tick are written in one store per port, and the timer interrupt fires
+// once per distinct edge, not once per channel. The timer runs in one-shot
+// steps (auto-reload preloaded with the length of the next step).
+//
+// Duty changes are built into a second schedule buffer and swapped in at the
+// end of a period, so the outputs never see a half-updated schedule.
+//
+// Edges closer than the interrupt latency (a few microseconds) are delayed;
+// keep frequency * resolution well below the CPU clock divided by ~200.
+// Each step lasts at least 2 ticks: a duty of 1 is output as 2, a duty of
+// resolution - 1 as resolution - 2, and channels whose duties differ by 1
+// switch together. resolution must be at least 4.
+class SoftwarePWM {
+public:
+  // timer: any free timer instance, its update interrupt is used.
+  // frequencyHz: PWM frequency, resolution: number of duty steps per period.
+  bool begin(TIM_TypeDef* timer, uint32_t frequencyHz, uint16_t resolution = 256);
+  void end();
+
+  // Add pin to the engine as an output with the given duty (0..resolution).
+  bool attach(uint32_t pin, uint16_t duty = 0);
+  // Remove pin from the engine and drive it low. Waits for the end of the
+  // running period (up to two periods).
+  void detach(uint32_t pin);
+
+  // Set the duty of pin and rebuild the schedule.
+  void write(uint32_t pin, uint16_t duty);
+  // Set the duty of pin without rebuilding; call update() after a batch.
+  void set(uint32_t pin, uint16_t duty);
+  // Build the schedule from the current duties, applied from the next period.
+  void update();
+
+  uint16_t read(uint32_t pin) const;
+
+  // Actual PWM frequency, as reachable by the timer.
+  uint32_t frequency();
+  uint16_t resolution() const { return resolution_; }
+  uint8_t channels() const { return count_; }
+  bool running() const { return running_; }
+
+  // Internal: timer update entrypoint
+  static void _handleUpdate();
+
+private:
+  struct Step {
+    uint16_t reset[MAX_NB_PORT];  // pins going low at this edge, per port
+    uint16_t reload;              // auto-reload value: step length - 1
+  };
+
+  struct Schedule {
+    uint32_t start[MAX_NB_PORT];  // BSRR word written at the period start
+    Step steps[SOFTWARE_PWM_CHANNELS + 1];
+    uint8_t count;
+  };
+
+  int indexOf(PinName pin) const;
+  void build(Schedule& schedule);
+
+  static SoftwarePWM* s_active;
+
+  HardwareTimer* timer_ = nullptr;
+  bool ownsTimer_ = false;
+  bool running_ = false;
+  uint16_t resolution_ = 256;
+
+  PinName pins_[SOFTWARE_PWM_CHANNELS];
+  uint16_t duties_[SOFTWARE_PWM_CHANNELS];
+  uint8_t count_ = 0;
+
+  Schedule schedules_[2];
+  volatile uint8_t active_ = 0;
+  volatile bool pending_ = false;
+  uint8_t step_ = 0;
+};
+
+#endif
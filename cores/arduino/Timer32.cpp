@@ -0,0 +1,154 @@
+#include "Arduino.h"
+#include "Timer32.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && defined(TIM3)
+
+// Reuse the timer object if the core already has one for this instance.
+static HardwareTimer* acquireTimer(TIM_TypeDef* tim, bool* owns)
+{
+  uint32_t index = get_timer_index(tim);
+  if (index != UNKNOWN_TIMER && HardwareTimer_Handle[index] != NULL && HardwareTimer_Handle[index]->__this != NULL) {
+    *owns = false;
+    return (HardwareTimer*)HardwareTimer_Handle[index]->__this;
+  }
+  *owns = true;
+  return new HardwareTimer(tim);
+}
+
+bool Timer32::begin(TIM_TypeDef* low, TIM_TypeDef* high, uint32_t tickHz)
+{
+  end();
+  if ((low == NULL) || (high == NULL) || (low == high)) {
+    return false;
+  }
+  low_ = acquireTimer(low, &ownsLow_);
+  high_ = acquireTimer(high, &ownsHigh_);
+
+  uint32_t clock = low_->getTimerClkFreq();
+  uint32_t prescaler = (tickHz != 0) ? (clock + tickHz / 2) / tickHz : 1;
+  if (prescaler == 0) {
+    prescaler = 1;
+  }
+  if (prescaler > 0x10000) {
+    end();
+    return false;
+  }
+  tickRate_ = clock / prescaler;
+
+  // Both timers are set up before the trigger link, or the update events
+  // generated here would already count on the high timer.
+  low_->pause();
+  high_->pause();
+  low_->setPrescaleFactor(prescaler);
+  low_->setOverflow(0x10000, TICK_FORMAT);
+  high_->setPrescaleFactor(1);
+  high_->setOverflow(0x10000, TICK_FORMAT);
+  if (!low_->setMasterOutput(TIMER_TRGO_UPDATE) || !high_->setSlaveMode(TIMER_SLAVE_EXTERNAL_CLOCK, low_)) {
+    end();
+    return false;
+  }
+  low_->setCount(0);
+  high_->setCount(0);
+  resume();
+  return true;
+}
+
+void Timer32::end()
+{
+  if (high_ != nullptr) {
+    high_->pause();
+    high_->detachInterrupt();
+    high_->setSlaveMode(TIMER_SLAVE_DISABLED);
+    if (ownsHigh_) {
+      delete high_;
+    }
+  }
+  if (low_ != nullptr) {
+    low_->pause();
+    low_->setMasterOutput(TIMER_TRGO_RESET);
+    if (ownsLow_) {
+      delete low_;
+    }
+  }
+  low_ = nullptr;
+  high_ = nullptr;
+  ownsLow_ = false;
+  ownsHigh_ = false;
+  tickRate_ = 0;
+}
+
+void Timer32::pause()
+{
+  if (low_ != nullptr) {
+    // The high timer only moves on rollovers of the low one.
+    low_->pause();
+  }
+}
+
+void Timer32::resume()
+{
+  if (low_ != nullptr) {
+    high_->resume();
+    low_->resume();
+  }
+}
+
+uint32_t Timer32::read()
+{
+  if (low_ == nullptr) {
+    return 0;
+  }
+  TIM_TypeDef* low = low_->getHandle()->Instance;
+  TIM_TypeDef* high = high_->getHandle()->Instance;
+  uint16_t upper;
+  uint16_t lower;
+
+  // Retry if the low counter rolled over between the reads. The high
+  // counter follows a rollover within its trigger resynchronization delay,
+  // which is shorter than the bus accesses between the low and second high
+  // reads, so a stale high half is always caught here.
+  do {
+    upper = (uint16_t)LL_TIM_GetCounter(high);
+    lower = (uint16_t)LL_TIM_GetCounter(low);
+  } while (upper != (uint16_t)LL_TIM_GetCounter(high));
+  return ((uint32_t)upper << 16) | lower;
+}
+
+void Timer32::write(uint32_t ticks)
+{
+  if (low_ == nullptr) {
+    return;
+  }
+  TIM_TypeDef* low = low_->getHandle()->Instance;
+  bool running = LL_TIM_IsEnabledCounter(low);
+
+  LL_TIM_DisableCounter(low);
+  LL_TIM_SetCounter(high_->getHandle()->Instance, ticks >> 16);
+  LL_TIM_SetCounter(low, ticks & 0xFFFF);
+  if (running) {
+    LL_TIM_EnableCounter(low);
+  }
+}
+
+void Timer32::attachInterrupt(void (*callback)(void))
+{
+  if (high_ != nullptr) {
+    high_->attachInterrupt(callback);
+  }
+}
+
+void Timer32::attachInterrupt(callback_arg_function_t callback, void* arg)
+{
+  if (high_ != nullptr) {
+    high_->attachInterrupt(callback, arg);
+  }
+}
+
+void Timer32::detachInterrupt()
+{
+  if (high_ != nullptr) {
+    high_->detachInterrupt();
+  }
+}
+
+#endif
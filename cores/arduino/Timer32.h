@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && defined(TIM3)
+
+#include "HardwareTimer.h"
+
+// A 32-bit counter made of two chained 16-bit timers, for long periods
+// measured at full timer resolution (65 s at 64 MHz).
+//
+// The low timer counts ticks and sends its rollover on TRGO. The high timer
+// counts those rollovers in external clock mode, over the internal trigger
+// line, so no interrupt or CPU time is involved. TIM1 and TIM3 are wired to
+// each other and can be chained in either order.
+class Timer32 {
+public:
+  // tickHz: counting rate, 0 for the undivided timer clock. The counter
+  // starts from 0. Returns false if the timers are not wired to each other.
+  bool begin(TIM_TypeDef* low, TIM_TypeDef* high, uint32_t tickHz = 0);
+  void end();
+
+  void pause();
+  void resume();
+
+  // Coherent 32-bit snapshot of the counter.
+  uint32_t read();
+  void write(uint32_t ticks);
+
+  uint32_t tickRate() const { return tickRate_; }
+
+  // Called when the 32-bit counter rolls over.
+  void attachInterrupt(void (*callback)(void));
+  void attachInterrupt(callback_arg_function_t callback, void* arg);
+  void detachInterrupt();
+
+private:
+  HardwareTimer* low_ = nullptr;
+  HardwareTimer* high_ = nullptr;
+  bool ownsLow_ = false;
+  bool ownsHigh_ = false;
+  uint32_t tickRate_ = 0;
+};
+
+#endif
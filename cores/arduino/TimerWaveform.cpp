@@ -0,0 +1,276 @@
+#include "Arduino.h"
+#include "TimerWaveform.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && \
+    defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+
+#include "HardwareTimer.h"
+#include "py32/dma.h"
+
+static const uint32_t llChannels[] = {
+  LL_TIM_CHANNEL_CH1,
+  LL_TIM_CHANNEL_CH2,
+  LL_TIM_CHANNEL_CH3,
+  LL_TIM_CHANNEL_CH4,
+};
+
+// DMA request raised by the update event of a timer, 0 if none.
+static uint32_t updateRequest(TIM_TypeDef* tim)
+{
+  if (tim == TIM1) {
+    return DMA_CHANNEL_MAP_TIM1_UP;
+  }
+#if defined(TIM3)
+  if (tim == TIM3) {
+    return DMA_CHANNEL_MAP_TIM3_UP;
+  }
+#endif
+#if defined(TIM16)
+  if (tim == TIM16) {
+    return DMA_CHANNEL_MAP_TIM16_UP;
+  }
+#endif
+#if defined(TIM17)
+  if (tim == TIM17) {
+    return DMA_CHANNEL_MAP_TIM17_UP;
+  }
+#endif
+  return 0;
+}
+
+bool TimerWaveform::begin(uint32_t pin, uint32_t tickHz, uint16_t periodTicks)
+{
+  end();
+  if (periodTicks < 2) {
+    return false;
+  }
+
+  PinName p = digitalPinToPinName(pin);
+  TIM_TypeDef* tim = (TIM_TypeDef*)pinmap_peripheral(p, PinMap_TIM);
+  if ((tim == NULL) || (updateRequest(tim) == 0)) {
+    return false;
+  }
+  uint32_t channel = PY32_PIN_CHANNEL(pinmap_function(p, PinMap_TIM));
+  if ((channel < 1) || (channel > 4)) {
+    return false;
+  }
+
+  // Reuse the timer object if the core already has one for this instance.
+  uint32_t index = get_timer_index(tim);
+  if (index != UNKNOWN_TIMER && HardwareTimer_Handle[index] != NULL && HardwareTimer_Handle[index]->__this != NULL) {
+    timer_ = (HardwareTimer*)HardwareTimer_Handle[index]->__this;
+    ownsTimer_ = false;
+  } else {
+    timer_ = new HardwareTimer(tim);
+    ownsTimer_ = true;
+  }
+
+  uint32_t clock = timer_->getTimerClkFreq();
+  uint32_t prescaler = (tickHz != 0) ? (clock + tickHz / 2) / tickHz : 1;
+  if (prescaler == 0) {
+    prescaler = 1;
+  }
+  if (prescaler > 0x10000) {
+    end();
+    return false;
+  }
+
+  instance_ = tim;
+  channel_ = channel;
+  ccr_ = &tim->CCR1 + (channel - 1);
+  dmaRequest_ = updateRequest(tim);
+  tickRate_ = clock / prescaler;
+  period_ = periodTicks;
+
+  timer_->pause();
+  timer_->setPrescaleFactor(prescaler);
+  timer_->setOverflow(periodTicks, TICK_FORMAT);
+  timer_->setPreloadEnable(true);
+  timer_->setMode(channel, TIMER_OUTPUT_COMPARE_PWM1, p);
+  timer_->setCaptureCompare(channel, 0);
+  LL_TIM_OC_EnablePreload(tim, llChannels[channel - 1]);
+  timer_->resume();
+  return true;
+}
+
+void TimerWaveform::end()
+{
+  stop();
+  if (timer_ != nullptr) {
+    timer_->pause();
+    LL_TIM_OC_DisablePreload(instance_, llChannels[channel_ - 1]);
+    timer_->setPreloadEnable(false);
+    timer_->setMode(channel_, TIMER_DISABLED);
+    if (ownsTimer_) {
+      delete timer_;
+    }
+    timer_ = nullptr;
+    ownsTimer_ = false;
+  }
+  instance_ = nullptr;
+}
+
+void TimerWaveform::setPeriod(uint16_t periodTicks)
+{
+  if (busy_ || (timer_ == nullptr) || (periodTicks < 2)) {
+    return;
+  }
+  period_ = periodTicks;
+  LL_TIM_SetAutoReload(instance_, period_ - 1);
+}
+
+bool TimerWaveform::start(uint32_t destination, const uint16_t* source, size_t count, uint32_t mode)
+{
+  dma_ = {};
+  if (dma_channel_claim(&dma_) == NULL) {
+    return false;
+  }
+  dma_.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+  dma_.Init.PeriphInc           = DMA_PINC_DISABLE;
+  dma_.Init.MemInc              = DMA_MINC_ENABLE;
+  dma_.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  dma_.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+  dma_.Init.Mode                = mode;
+  dma_.Init.Priority            = DMA_PRIORITY_VERY_HIGH;
+  if (HAL_DMA_Init(&dma_) != HAL_OK) {
+    dma_channel_release(&dma_);
+    return false;
+  }
+  HAL_DMA_ChannelMap(&dma_, dmaRequest_);
+  dma_.Parent = this;
+  dma_.XferCpltCallback = dmaComplete;
+  dma_.XferHalfCpltCallback = (mode == DMA_CIRCULAR) ? dmaHalfComplete : nullptr;
+
+  busy_ = true;
+  if (HAL_DMA_Start_IT(&dma_, (uint32_t)source, destination, count) != HAL_OK) {
+    dma_channel_release(&dma_);
+    busy_ = false;
+    return false;
+  }
+  // The first request comes with the next update event: the words are
+  // written to the preload registers and take effect one period later.
+  LL_TIM_EnableDMAReq_UPDATE(instance_);
+  return true;
+}
+
+bool TimerWaveform::write(const uint16_t* words, size_t count, DoneCallback done, void* context)
+{
+  if (busy_ || (timer_ == nullptr) || (words == nullptr) || (count == 0) || (count > 0xFFFF)) {
+    return false;
+  }
+  done_ = done;
+  context_ = context;
+  refill_ = nullptr;
+  LL_TIM_SetAutoReload(instance_, period_ - 1);
+  return start((uint32_t)ccr_, words, count, DMA_NORMAL);
+}
+
+bool TimerWaveform::writeFrames(const uint16_t* frames, size_t count, DoneCallback done, void* context)
+{
+  // ARR, RCR, then CCR1 up to our channel: contiguous from ARR.
+  size_t words = 2 + channel_;
+
+  if (busy_ || (timer_ == nullptr) || (frames == nullptr) || (count == 0) || (count * words > 0xFFFF)) {
+    return false;
+  }
+  done_ = done;
+  context_ = context;
+  refill_ = nullptr;
+  burst_ = true;
+  LL_TIM_ConfigDMABurst(instance_, LL_TIM_DMABURST_BASEADDR_ARR, (words - 1) << TIM_DCR_DBL_Pos);
+  if (!start((uint32_t)&instance_->DMAR, frames, count * words, DMA_NORMAL)) {
+    burst_ = false;
+    return false;
+  }
+  return true;
+}
+
+bool TimerWaveform::stream(uint16_t* buffer, size_t count, RefillCallback refill, void* context,
+                           DoneCallback done)
+{
+  if (busy_ || (timer_ == nullptr) || (buffer == nullptr) || (count < 2) || ((count & 1) != 0) ||
+      (count > 0xFFFF) || (refill == nullptr)) {
+    return false;
+  }
+  streamBuffer_ = buffer;
+  streamHalf_ = count / 2;
+  refill_ = refill;
+  context_ = context;
+  done_ = done;
+  ending_ = false;
+  LL_TIM_SetAutoReload(instance_, period_ - 1);
+  refillHalf(0);
+  refillHalf(1);
+  return start((uint32_t)ccr_, buffer, count, DMA_CIRCULAR);
+}
+
+void TimerWaveform::refillHalf(uint8_t half)
+{
+  uint16_t* words = streamBuffer_ + half * streamHalf_;
+  size_t filled = 0;
+
+  if (!ending_) {
+    filled = refill_(words, streamHalf_, context_);
+    if (filled < streamHalf_) {
+      // Last data: the stream stops once this half has been sent.
+      ending_ = true;
+      lastHalf_ = half;
+    }
+  }
+  for (size_t i = filled; i < streamHalf_; i++) {
+    words[i] = 0;
+  }
+}
+
+void TimerWaveform::finish()
+{
+  LL_TIM_DisableDMAReq_UPDATE(instance_);
+  dma_channel_release(&dma_);
+  if (burst_) {
+    burst_ = false;
+    LL_TIM_ConfigDMABurst(instance_, 0, 0);
+  }
+  busy_ = false;
+  if (done_ != nullptr) {
+    done_(context_);
+  }
+}
+
+void TimerWaveform::stop()
+{
+  if (!busy_) {
+    return;
+  }
+  done_ = nullptr;
+  finish();
+  // Takes effect at the next update, after the period in progress.
+  *ccr_ = 0;
+}
+
+void TimerWaveform::dmaHalfComplete(DMA_HandleTypeDef* hdma)
+{
+  TimerWaveform* self = (TimerWaveform*)hdma->Parent;
+
+  if (self->ending_ && (self->lastHalf_ == 0)) {
+    self->finish();
+  } else {
+    self->refillHalf(0);
+  }
+}
+
+void TimerWaveform::dmaComplete(DMA_HandleTypeDef* hdma)
+{
+  TimerWaveform* self = (TimerWaveform*)hdma->Parent;
+
+  if (self->refill_ == nullptr) {
+    // write()/writeFrames(): the last word is in the preload registers and
+    // plays for one more period.
+    self->finish();
+  } else if (self->ending_ && (self->lastHalf_ == 1)) {
+    self->finish();
+  } else {
+    self->refillHalf(1);
+  }
+}
+
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && \
+    defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+
+// Waveforms streamed to a timer output by DMA, one word per timer period.
+//
+// The pin's channel runs in PWM mode 1 with preloaded compare and
+// auto-reload registers. Each update event requests a DMA transfer that
+// writes the values for the next period, so edges land on exact timer
+// ticks whatever the CPU is doing. Three ways to feed it:
+//
+// - write(): one compare value per period from a buffer in memory.
+// - writeFrames(): per-period ARR/CCR bursts (TIMx_DMAR), so both the
+//   period and the high time of every pulse can change.
+// - stream(): compare values from a circular buffer refilled half by half
+//   from the DMA interrupt; the source never needs to be expanded in RAM.
+//
+// The output idles low (compare 0) between transfers.
+class TimerWaveform {
+public:
+  // Fill half with up to count words, return how many were written: fewer
+  // than count ends the stream once those words are out. From interrupt.
+  typedef size_t (*RefillCallback)(uint16_t* half, size_t count, void* context);
+  typedef void (*DoneCallback)(void* context);
+
+  // tickHz: counting rate, 0 for the full timer clock.
+  // periodTicks: length of one period (one word) in ticks.
+  bool begin(uint32_t pin, uint32_t tickHz, uint16_t periodTicks);
+  void end();
+
+  // Change the period length, from the next period. Not while busy().
+  void setPeriod(uint16_t periodTicks);
+
+  // Compare value of each period. End with 0 to leave the pin low.
+  bool write(const uint16_t* words, size_t count, DoneCallback done = nullptr, void* context = nullptr);
+
+  // Frames of ARR, RCR, CCR1 .. CCRn (n = the pin's channel), one per
+  // period: ARR sets the length of the period, CCRn its high time.
+  bool writeFrames(const uint16_t* frames, size_t count, DoneCallback done = nullptr, void* context = nullptr);
+
+  // Circular stream through buffer (count words, even). refill is called
+  // for both halves before the start, then for each half as it is sent.
+  bool stream(uint16_t* buffer, size_t count, RefillCallback refill, void* context = nullptr,
+              DoneCallback done = nullptr);
+
+  // Abort any transfer and drive the pin low.
+  void stop();
+
+  bool busy() const { return busy_; }
+
+  uint32_t tickRate() const { return tickRate_; }
+  uint16_t period() const { return period_; }
+
+private:
+  bool start(uint32_t destination, const uint16_t* source, size_t count, uint32_t mode);
+  void finish();
+  void refillHalf(uint8_t half);
+
+  static void dmaHalfComplete(DMA_HandleTypeDef* hdma);
+  static void dmaComplete(DMA_HandleTypeDef* hdma);
+
+  HardwareTimer* timer_ = nullptr;
+  bool ownsTimer_ = false;
+  TIM_TypeDef* instance_ = nullptr;
+  uint8_t channel_ = 0;
+  volatile uint32_t* ccr_ = nullptr;
+  uint32_t dmaRequest_ = 0;
+  uint32_t tickRate_ = 0;
+  uint16_t period_ = 0;
+
+  DMA_HandleTypeDef dma_ = {};
+  volatile bool busy_ = false;
+  bool burst_ = false;
+
+  uint16_t* streamBuffer_ = nullptr;
+  size_t streamHalf_ = 0;
+  RefillCallback refill_ = nullptr;
+  bool ending_ = false;
+  uint8_t lastHalf_ = 0;
+
+  DoneCallback done_ = nullptr;
+  void* context_ = nullptr;
+};
+
+#endif
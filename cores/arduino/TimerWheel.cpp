@@ -0,0 +1,389 @@
+#include "Arduino.h"
+#include "TimerWheel.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+static_assert(TIMERWHEEL_SLOT_BITS <= 5, "TIMERWHEEL_SLOT_BITS: at most 32 slots per level");
+static_assert(TIMERWHEEL_LEVELS * TIMERWHEEL_SLOT_BITS <= 32, "TimerWheel: range over 32 bits");
+
+bool TimerWheel::begin(TIM_TypeDef* tim, uint32_t tickHz)
+{
+  end();
+  if ((tim == NULL) || (tickHz == 0)) {
+    return false;
+  }
+
+  // Reuse the timer object if the core already has one for this instance.
+  uint32_t index = get_timer_index(tim);
+  if (index != UNKNOWN_TIMER && HardwareTimer_Handle[index] != NULL && HardwareTimer_Handle[index]->__this != NULL) {
+    timer_ = (HardwareTimer*)HardwareTimer_Handle[index]->__this;
+    ownsTimer_ = false;
+  } else {
+    timer_ = new HardwareTimer(tim);
+    ownsTimer_ = true;
+  }
+
+  uint32_t clock = timer_->getTimerClkFreq();
+  uint32_t prescaler = (clock + tickHz / 2) / tickHz;
+  if (prescaler == 0) {
+    prescaler = 1;
+  }
+  if (prescaler > 0x10000) {
+    // Slowest rate the 16-bit prescaler reaches, e.g. ~1099 Hz for 1 kHz on
+    // a 72 MHz clock: tickRate() and msToTicks() give the actual rate.
+    prescaler = 0x10000;
+  }
+  instance_ = tim;
+  tickRate_ = clock / prescaler;
+  now_ = 0;
+  overflows_ = 0;
+  lastHardware_ = 0;
+
+  timer_->pause();
+  timer_->setPrescaleFactor(prescaler);
+  timer_->setOverflow(0x10000, TICK_FORMAT);
+  timer_->setMode(1, TIMER_DISABLED);
+  timer_->setCount(0);
+  timer_->attachInterrupt(overflowCallback, this);
+  timer_->attachInterrupt(1, compareCallback, this);
+  timer_->resume();
+  // The compare interrupt is only enabled while an expiry is in range.
+  LL_TIM_DisableIT_CC1(tim);
+  return true;
+}
+
+void TimerWheel::end()
+{
+  if (timer_ == nullptr) {
+    return;
+  }
+  timer_->pause();
+  timer_->detachInterrupt();
+  timer_->detachInterrupt(1);
+  if (ownsTimer_) {
+    delete timer_;
+  }
+  timer_ = nullptr;
+  ownsTimer_ = false;
+  instance_ = nullptr;
+
+  // Timers still started are dropped.
+  for (uint8_t level = 0; level < TIMERWHEEL_LEVELS; level++) {
+    for (uint32_t index = 0; index < kSlots; index++) {
+      for (WheelTimer* timer = slots_[level][index]; timer != nullptr; timer = timer->next_) {
+        timer->flags_ &= ~WheelTimer::ARMED;
+      }
+      slots_[level][index] = nullptr;
+    }
+    occupied_[level] = 0;
+  }
+  while (pending_ != nullptr) {
+    pending_->flags_ &= ~(WheelTimer::PENDING | WheelTimer::QUEUED);
+    pending_ = pending_->pendingNext_;
+  }
+}
+
+uint32_t TimerWheel::msToTicks(uint32_t ms) const
+{
+  return (uint32_t)(((uint64_t)ms * tickRate_) / 1000);
+}
+
+uint32_t TimerWheel::now()
+{
+  if (instance_ == nullptr) {
+    return 0;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t ticks = hardwareNow();
+  __set_PRIMASK(primask);
+  return ticks;
+}
+
+// 32-bit time from the 16-bit counter and the overflow count. Interrupts
+// disabled.
+uint32_t TimerWheel::hardwareNow()
+{
+  uint32_t high = overflows_;
+  uint32_t low = LL_TIM_GetCounter(instance_) & 0xFFFF;
+
+  // Overflow not handled yet: the counter has just wrapped.
+  if (LL_TIM_IsActiveFlag_UPDATE(instance_) && (low < 0x8000)) {
+    high++;
+  }
+  uint32_t ticks = (high << 16) | low;
+  // Read from an interrupt that preempted the overflow handler, between
+  // its flag clear and count.
+  if ((int32_t)(ticks - lastHardware_) < 0) {
+    ticks += 0x10000;
+  }
+  lastHardware_ = ticks;
+  return ticks;
+}
+
+void TimerWheel::insert(WheelTimer* timer)
+{
+  uint32_t delta = timer->expires_ - now_;
+  uint32_t key = timer->expires_;
+  uint8_t level = 0;
+
+  if ((int32_t)delta < 0) {
+    // Already due: next tick processed.
+    delta = 0;
+    key = now_;
+  } else if (delta > kRange) {
+    // Beyond the wheel: parked at the far end of the last level.
+    key = now_ + kRange;
+    level = TIMERWHEEL_LEVELS - 1;
+  }
+  while ((level < TIMERWHEEL_LEVELS - 1) && (delta >> (TIMERWHEEL_SLOT_BITS * (level + 1)))) {
+    level++;
+  }
+
+  uint32_t index = (key >> (TIMERWHEEL_SLOT_BITS * level)) & kMask;
+  WheelTimer** head = &slots_[level][index];
+  timer->next_ = *head;
+  if (*head != nullptr) {
+    (*head)->pprev_ = &timer->next_;
+  }
+  timer->pprev_ = head;
+  *head = timer;
+  occupied_[level] |= 1UL << index;
+}
+
+void TimerWheel::unlink(WheelTimer* timer)
+{
+  WheelTimer** head = timer->pprev_;
+
+  *head = timer->next_;
+  if (timer->next_ != nullptr) {
+    timer->next_->pprev_ = head;
+  } else if ((head >= &slots_[0][0]) && (head < &slots_[0][0] + TIMERWHEEL_LEVELS * kSlots)) {
+    // Was alone in its slot.
+    uint32_t slot = head - &slots_[0][0];
+    occupied_[slot / kSlots] &= ~(1UL << (slot % kSlots));
+  }
+  timer->next_ = nullptr;
+  timer->pprev_ = nullptr;
+}
+
+// Earliest tick at which a level 0 slot expires or an upper slot has to be
+// spread into the lower levels. Slot i of level L is handled at the first
+// multiple of 2^(L * SLOT_BITS), from now_ on, whose level L digit is i.
+bool TimerWheel::nextEvent(uint32_t* tick)
+{
+  bool found = false;
+  uint32_t nearest = 0;
+
+  for (uint8_t level = 0; level < TIMERWHEEL_LEVELS; level++) {
+    uint32_t occupied = occupied_[level];
+    if (occupied == 0) {
+      continue;
+    }
+    uint32_t shift = TIMERWHEEL_SLOT_BITS * level;
+    uint32_t base = (now_ + ((1UL << shift) - 1)) >> shift;
+    uint32_t start = base & kMask;
+    uint64_t rotated = (((uint64_t)occupied << kSlots) | occupied) >> start;
+    uint32_t steps = __builtin_ctz((uint32_t)rotated);
+    uint32_t delta = ((base + steps) << shift) - now_;
+
+    if (!found || (delta < nearest)) {
+      nearest = delta;
+      found = true;
+    }
+  }
+  *tick = now_ + nearest;
+  return found;
+}
+
+void TimerWheel::cascade(uint8_t level, uint32_t index)
+{
+  WheelTimer* timer = slots_[level][index];
+
+  slots_[level][index] = nullptr;
+  occupied_[level] &= ~(1UL << index);
+  while (timer != nullptr) {
+    WheelTimer* next = timer->next_;
+    insert(timer);
+    timer = next;
+  }
+}
+
+// Level 0 slot of now_: run or queue its timers. Interrupts disabled, but
+// enabled around interrupt callbacks.
+void TimerWheel::expire(uint32_t index)
+{
+  WheelTimer* timer;
+
+  while ((timer = slots_[0][index]) != nullptr) {
+    unlink(timer);
+    uint8_t flags = timer->flags_ & ~WheelTimer::ARMED;
+    if (timer->period_ != 0) {
+      // Next period from the previous expiry, skipping missed ones.
+      uint32_t late = now_ - timer->expires_;
+      timer->expires_ += (late / timer->period_ + 1) * timer->period_;
+      insert(timer);
+      flags |= WheelTimer::ARMED;
+    }
+    if (flags & WheelTimer::DEFERRED) {
+      flags |= WheelTimer::PENDING;
+      if (!(flags & WheelTimer::QUEUED)) {
+        flags |= WheelTimer::QUEUED;
+        timer->pendingNext_ = pending_;
+        pending_ = timer;
+      }
+      timer->flags_ = flags;
+    } else {
+      WheelTimer::Callback callback = timer->callback_;
+      void* arg = timer->arg_;
+      timer->flags_ = flags;
+      __enable_irq();
+      callback(arg);
+      __disable_irq();
+    }
+  }
+}
+
+// Set the compare channel to the next event. Returns true if it is already
+// due. Interrupts disabled.
+bool TimerWheel::program()
+{
+  uint32_t tick;
+
+  if (!nextEvent(&tick)) {
+    LL_TIM_DisableIT_CC1(instance_);
+    return false;
+  }
+  uint32_t ahead = tick - hardwareNow();
+  if ((int32_t)ahead <= 0) {
+    return true;
+  }
+  if (ahead > 0xFFFF) {
+    // The overflow interrupt comes first and programs it again.
+    LL_TIM_DisableIT_CC1(instance_);
+    return false;
+  }
+  LL_TIM_OC_SetCompareCH1(instance_, tick & 0xFFFF);
+  LL_TIM_ClearFlag_CC1(instance_);
+  LL_TIM_EnableIT_CC1(instance_);
+  // A match between the two writes above was lost.
+  return (int32_t)(hardwareNow() - tick) >= 0;
+}
+
+// Timer interrupt: handle everything due, then set the next compare.
+void TimerWheel::process()
+{
+  __disable_irq();
+  if (!processing_) {
+    processing_ = true;
+    do {
+      uint32_t hardware = hardwareNow();
+      uint32_t tick;
+
+      while (nextEvent(&tick) && ((int32_t)(tick - hardware) <= 0)) {
+        now_ = tick;
+        for (uint8_t level = 1; level < TIMERWHEEL_LEVELS; level++) {
+          uint32_t shift = TIMERWHEEL_SLOT_BITS * level;
+          if (tick & ((1UL << shift) - 1)) {
+            break;
+          }
+          cascade(level, (tick >> shift) & kMask);
+        }
+        expire(tick & kMask);
+        now_ = tick + 1;
+        hardware = hardwareNow();
+      }
+      // Nothing happens until then: skip the idle ticks.
+      if ((int32_t)(hardware + 1 - now_) > 0) {
+        now_ = hardware + 1;
+      }
+    } while (program());
+    processing_ = false;
+  }
+  __enable_irq();
+}
+
+void TimerWheel::overflowCallback(void* self)
+{
+  TimerWheel* wheel = (TimerWheel*)self;
+
+  wheel->overflows_++;
+  wheel->process();
+}
+
+void TimerWheel::compareCallback(void* self)
+{
+  ((TimerWheel*)self)->process();
+}
+
+void TimerWheel::start(WheelTimer& timer, uint32_t delay, uint32_t period,
+                       WheelTimer::Callback callback, void* arg, bool inInterrupt)
+{
+  if ((instance_ == nullptr) || (callback == nullptr)) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (timer.flags_ & WheelTimer::ARMED) {
+    unlink(&timer);
+  }
+  uint32_t hardware = hardwareNow();
+  uint32_t tick;
+  if (!processing_ && (!nextEvent(&tick) || ((int32_t)(tick - hardware) > 0)) &&
+      ((int32_t)(hardware + 1 - now_) > 0)) {
+    // Idle since the last interrupt: catch up, so that the timer lands in
+    // its final level right away.
+    now_ = hardware + 1;
+  }
+  timer.callback_ = callback;
+  timer.arg_ = arg;
+  timer.period_ = period;
+  timer.expires_ = hardware + ((delay != 0) ? delay : 1);
+  timer.flags_ = (timer.flags_ & WheelTimer::QUEUED) | WheelTimer::ARMED |
+                 (inInterrupt ? 0 : WheelTimer::DEFERRED);
+  insert(&timer);
+  if (!processing_ && program()) {
+    // Due already: let the interrupt handle it.
+    LL_TIM_EnableIT_CC1(instance_);
+    LL_TIM_GenerateEvent_CC1(instance_);
+  }
+  __set_PRIMASK(primask);
+}
+
+void TimerWheel::cancel(WheelTimer& timer)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (timer.flags_ & WheelTimer::ARMED) {
+    unlink(&timer);
+  }
+  // Still QUEUED: poll() drops it.
+  timer.flags_ &= ~(WheelTimer::ARMED | WheelTimer::PENDING);
+  __set_PRIMASK(primask);
+}
+
+void TimerWheel::poll()
+{
+  for (;;) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    WheelTimer* timer = pending_;
+    if (timer == nullptr) {
+      __set_PRIMASK(primask);
+      return;
+    }
+    pending_ = timer->pendingNext_;
+    timer->pendingNext_ = nullptr;
+    uint8_t flags = timer->flags_;
+    timer->flags_ = flags & ~(WheelTimer::PENDING | WheelTimer::QUEUED);
+    WheelTimer::Callback callback = timer->callback_;
+    void* arg = timer->arg_;
+    __set_PRIMASK(primask);
+
+    if (flags & WheelTimer::PENDING) {
+      callback(arg);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+
+#include "HardwareTimer.h"
+
+// Wheel geometry: TIMERWHEEL_LEVELS levels of 2^TIMERWHEEL_SLOT_BITS slots,
+// one list head each (4 levels of 16: 256 bytes). Timers further away than
+// 2^(LEVELS * SLOT_BITS) ticks (65 s at 1 kHz) wait in the last level and
+// are placed again each time it turns.
+#ifndef TIMERWHEEL_LEVELS
+#define TIMERWHEEL_LEVELS 4
+#endif
+#ifndef TIMERWHEEL_SLOT_BITS
+#define TIMERWHEEL_SLOT_BITS 4
+#endif
+
+class TimerWheel;
+
+// A one-shot or periodic timer of a TimerWheel. Owned by the caller, no
+// heap: it must stay in place while it is started.
+class WheelTimer {
+public:
+  typedef void (*Callback)(void* arg);
+
+  bool active() const { return (flags_ & ARMED) != 0; }
+
+private:
+  friend class TimerWheel;
+
+  enum : uint8_t {
+    ARMED = 0x01,     // in the wheel
+    DEFERRED = 0x02,  // callback runs from TimerWheel::poll()
+    PENDING = 0x04,   // expired, callback due in poll()
+    QUEUED = 0x08,    // in the pending list
+  };
+
+  WheelTimer* next_ = nullptr;
+  WheelTimer** pprev_ = nullptr;
+  WheelTimer* pendingNext_ = nullptr;
+  uint32_t expires_ = 0;
+  uint32_t period_ = 0;
+  Callback callback_ = nullptr;
+  void* arg_ = nullptr;
+  volatile uint8_t flags_ = 0;
+};
+
+// Software timers on one hardware timer, as a hierarchical timing wheel.
+//
+// start() and cancel() are O(1): a timer is linked into the slot of its
+// expiry time, at the level matching how far away it is, and unlinked
+// through its back pointer. Slots of the upper levels are spread into the
+// lower ones as time reaches them.
+//
+// Tickless: the hardware counter runs freely and its compare channel 1 is
+// set to the nearest expiry or spread; the only other interrupt is the
+// 16-bit counter overflow. Callbacks run in the timer interrupt, or are
+// deferred to poll(), called from loop().
+class TimerWheel {
+public:
+  // tim: a free timer, used with its channel 1 (no pin). tickHz: time unit
+  // of start() delays. Below timer clock / 65536 the rate is clamped there:
+  // check tickRate(), or convert delays with msToTicks().
+  bool begin(TIM_TypeDef* tim, uint32_t tickHz = 1000);
+  void end();
+
+  // Call callback(arg) delay ticks from now (at least 1), then every period
+  // ticks if not 0. inInterrupt: run it in the timer interrupt, otherwise
+  // from poll(). Restarts the timer if it is active. Periodic timers do not
+  // drift; missed periods are skipped, not caught up.
+  void start(WheelTimer& timer, uint32_t delay, uint32_t period,
+             WheelTimer::Callback callback, void* arg = nullptr, bool inInterrupt = false);
+  void cancel(WheelTimer& timer);
+
+  // Run the deferred callbacks that are due.
+  void poll();
+
+  // Current time, in ticks.
+  uint32_t now();
+  uint32_t tickRate() const { return tickRate_; }
+  uint32_t msToTicks(uint32_t ms) const;
+
+private:
+  static const uint32_t kSlots = 1UL << TIMERWHEEL_SLOT_BITS;
+  static const uint32_t kMask = kSlots - 1;
+  static const uint64_t kSpan = 1ULL << (TIMERWHEEL_LEVELS * TIMERWHEEL_SLOT_BITS);
+  static const uint32_t kRange = (kSpan > 0x80000000ULL) ? 0x7FFFFFFFUL : (uint32_t)(kSpan - 1);
+
+  static void overflowCallback(void* self);
+  static void compareCallback(void* self);
+
+  uint32_t hardwareNow();
+  void insert(WheelTimer* timer);
+  void unlink(WheelTimer* timer);
+  bool nextEvent(uint32_t* tick);
+  void cascade(uint8_t level, uint32_t index);
+  void expire(uint32_t index);
+  bool program();
+  void process();
+
+  HardwareTimer* timer_ = nullptr;
+  TIM_TypeDef* instance_ = nullptr;
+  bool ownsTimer_ = false;
+  uint32_t tickRate_ = 0;
+
+  WheelTimer* slots_[TIMERWHEEL_LEVELS][kSlots] = {};
+  uint32_t occupied_[TIMERWHEEL_LEVELS] = {};  // bit per non-empty slot
+  uint32_t now_ = 0;        // next tick to process
+  volatile uint32_t overflows_ = 0;
+  uint32_t lastHardware_ = 0;
+  WheelTimer* pending_ = nullptr;
+  bool processing_ = false;
+};
+
+#endif
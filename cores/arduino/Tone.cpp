@@ -29,12 +29,20 @@
 typedef struct {
   PinName pin;
   int32_t count;
+  GPIO_TypeDef *port;       // software toggling
+  uint32_t mask;
+  HardwareTimer *timer;     // timer toggling the pin itself, NULL if none
+  uint32_t channel;
+  uint32_t batch;           // toggles until the next update interrupt
 } timerPinInfo_t;
 
 static void timerTonePinInit(PinName p, uint32_t frequency, uint32_t duration);
 static void tonePeriodElapsedCallback();
-static timerPinInfo_t TimerTone_pinInfo = {NC, 0};
+static void toneBatchElapsedCallback();
+static timerPinInfo_t TimerTone_pinInfo = {NC, 0, NULL, 0, NULL, 0, 0};
 static HardwareTimer *TimerTone = NULL;
+// Timer of the tone pin, when it is not TIMER_TONE
+static HardwareTimer *TimerTonePin = NULL;
 
 /**
   * @brief  Tone Period elapsed callback in non-blocking mode
@@ -43,20 +51,67 @@ static HardwareTimer *TimerTone = NULL;
   */
 static void tonePeriodElapsedCallback()
 {
-  GPIO_TypeDef *port = get_GPIO_Port(PY32_PORT(TimerTone_pinInfo.pin));
+  GPIO_TypeDef *port = TimerTone_pinInfo.port;
 
   if (port != NULL) {
     if (TimerTone_pinInfo.count != 0) {
       if (TimerTone_pinInfo.count > 0) {
         TimerTone_pinInfo.count--;
       }
-      digital_io_toggle(port, PY32_LL_GPIO_PIN(TimerTone_pinInfo.pin));
+      digital_io_toggle(port, TimerTone_pinInfo.mask);
     } else {
-      digital_io_write(port, PY32_LL_GPIO_PIN(TimerTone_pinInfo.pin), 0);
+      digital_io_write(port, TimerTone_pinInfo.mask, 0);
     }
   }
 }
 
+/**
+  * @brief  Update callback of a pin toggled by its timer: counts the toggles
+  *         of the last repetition batch, stops the timer after the last one
+  * @retval None
+  */
+static void toneBatchElapsedCallback()
+{
+  TimerTone_pinInfo.count -= TimerTone_pinInfo.batch;
+  if (IS_TIM_REPETITION_COUNTER_INSTANCE(TimerTone_pinInfo.timer->getHandle()->Instance)) {
+    TimerTone_pinInfo.batch = 256;
+  }
+  if (TimerTone_pinInfo.count <= 0) {
+    // Even number of toggles: the output is back to low
+    TimerTone_pinInfo.timer->pause();
+  }
+}
+
+/**
+  * @brief  Timer able to toggle pin p in hardware, NULL if it has none or
+  *         if its timer is already used by something else (PWM, Servo...)
+  * @param  p : pin
+  * @retval HardwareTimer object
+  */
+static HardwareTimer *timerTonePinTimer(PinName p)
+{
+  TIM_TypeDef *tim = (TIM_TypeDef *)pinmap_peripheral(p, PinMap_TIM);
+
+  if (tim == NULL) {
+    return NULL;
+  }
+  if (tim == TIMER_TONE) {
+    return TimerTone;
+  }
+  if ((TimerTonePin != NULL) && (TimerTonePin->getHandle()->Instance == tim)) {
+    return TimerTonePin;
+  }
+  uint32_t index = get_timer_index(tim);
+  if ((index == UNKNOWN_TIMER) || ((HardwareTimer_Handle[index] != NULL) && (HardwareTimer_Handle[index]->__this != NULL))) {
+    return NULL;
+  }
+  if (TimerTonePin != NULL) {
+    delete (TimerTonePin);
+  }
+  TimerTonePin = new HardwareTimer(tim);
+  return TimerTonePin;
+}
+
 /**
   * @brief  This function will reset the tone timer
   * @param  port : pointer to port
@@ -68,24 +123,113 @@ static void timerTonePinDeinit()
   if (TimerTone != NULL) {
     TimerTone->timerHandleDeinit();
   }
+  if (TimerTonePin != NULL) {
+    TimerTonePin->timerHandleDeinit();
+    delete (TimerTonePin);
+    TimerTonePin = NULL;
+  }
+  TimerTone_pinInfo.timer = NULL;
   if (TimerTone_pinInfo.pin != NC) {
     pin_function(TimerTone_pinInfo.pin, PY32_PIN_DATA(PY32_MODE_INPUT, GPIO_NOPULL, 0));
     TimerTone_pinInfo.pin = NC;
   }
 }
 
+/**
+  * @brief  Stop the tone, output low
+  * @retval None
+  */
+static void timerTonePinStop()
+{
+  HardwareTimer *timer = TimerTone_pinInfo.timer;
+
+  if (timer != NULL) {
+    timer->pause();
+    timer->setMode(TimerTone_pinInfo.channel, TIMER_OUTPUT_COMPARE_FORCED_INACTIVE, TimerTone_pinInfo.pin);
+  } else if (TimerTone != NULL) {
+    TimerTone->pause();
+  }
+}
+
+/**
+  * @brief  Toggle p in hardware: output compare toggle mode on its timer
+  *         channel, at every update event. No CPU per edge; with a duration
+  *         the update interrupt counts the toggles, in batches of up to 256
+  *         with the repetition counter where the timer has one.
+  * @param  p : pin
+  * @param  timer : timer of the pin
+  * @param  frequency : tone frequency
+  * @param  duration : duration in ms, 0 for infinite
+  * @retval None
+  */
+static void timerTonePinInitHardware(PinName p, HardwareTimer *timer, uint32_t frequency, uint32_t duration)
+{
+  TIM_TypeDef *tim = timer->getHandle()->Instance;
+  uint32_t channel = PY32_PIN_CHANNEL(pinmap_function(p, PinMap_TIM));
+
+  if ((TimerTone_pinInfo.timer != NULL) && (TimerTone_pinInfo.timer != timer)) {
+    TimerTone_pinInfo.timer->pause();
+  }
+  TimerTone_pinInfo.timer = timer;
+  TimerTone_pinInfo.channel = channel;
+  TimerTone_pinInfo.port = NULL;
+
+  timer->pause();
+  // Start low, so that an even number of toggles ends low
+  timer->setMode(channel, TIMER_OUTPUT_COMPARE_FORCED_INACTIVE, p);
+  timer->setOverflow(2 * frequency, HERTZ_FORMAT);
+  timer->setCaptureCompare(channel, 0);
+  timer->setMode(channel, TIMER_OUTPUT_COMPARE_TOGGLE, p);
+
+  if (duration > 0) {
+    uint64_t toggles = ((uint64_t)2 * frequency * duration) / 1000;
+    if (toggles > 0x7FFFFFFE) {
+      toggles = 0x7FFFFFFE;
+    }
+    TimerTone_pinInfo.count = (int32_t)((toggles + 1) & ~1ULL);
+    if (TimerTone_pinInfo.count == 0) {
+      TimerTone_pinInfo.count = 2;
+    }
+    TimerTone_pinInfo.batch = 1;
+    if (IS_TIM_REPETITION_COUNTER_INSTANCE(tim)) {
+      // First batch takes the remainder, the following ones 256 toggles
+      TimerTone_pinInfo.batch = ((TimerTone_pinInfo.count - 1) & 0xFF) + 1;
+      LL_TIM_SetRepetitionCounter(tim, TimerTone_pinInfo.batch - 1);
+      LL_TIM_GenerateEvent_UPDATE(tim);
+      LL_TIM_SetRepetitionCounter(tim, 255);
+    }
+    timer->attachInterrupt(toneBatchElapsedCallback);
+  } else {
+    TimerTone_pinInfo.count = -1;
+    if (IS_TIM_REPETITION_COUNTER_INSTANCE(tim)) {
+      LL_TIM_SetRepetitionCounter(tim, 0);
+      LL_TIM_GenerateEvent_UPDATE(tim);
+    }
+    timer->detachInterrupt();
+  }
+  timer->resume();
+}
+
 static void timerTonePinInit(PinName p, uint32_t frequency, uint32_t duration)
 {
   uint32_t timFreq = 2 * frequency;
 
   if (frequency <= MAX_FREQ) {
     if (frequency == 0) {
-      if (TimerTone != NULL) {
-        TimerTone->pause();
-      }
+      timerTonePinStop();
     } else {
       TimerTone_pinInfo.pin = p;
 
+      HardwareTimer *timer = timerTonePinTimer(p);
+      if (timer != NULL) {
+        timerTonePinInitHardware(p, timer, frequency, duration);
+        return;
+      }
+      if (TimerTone_pinInfo.timer != NULL) {
+        timerTonePinStop();
+        TimerTone_pinInfo.timer = NULL;
+      }
+
       //Calculate the toggle count
       if (duration > 0) {
         TimerTone_pinInfo.count = ((timFreq * duration) / 1000);
@@ -94,6 +238,8 @@ static void timerTonePinInit(PinName p, uint32_t frequency, uint32_t duration)
       }
 
       pin_function(TimerTone_pinInfo.pin, PY32_PIN_DATA(PY32_MODE_OUTPUT_PP, GPIO_NOPULL, 0));
+      TimerTone_pinInfo.port = get_GPIO_Port(PY32_PORT(p));
+      TimerTone_pinInfo.mask = PY32_LL_GPIO_PIN(p);
 
       TimerTone->setOverflow(timFreq, HERTZ_FORMAT);
       TimerTone->attachInterrupt(tonePeriodElapsedCallback);
@@ -127,7 +273,7 @@ void noTone(uint8_t _pin, bool destruct)
       delete (TimerTone);
       TimerTone = NULL;
     } else {
-      TimerTone->pause();
+      timerTonePinStop();
     }
   }
 }
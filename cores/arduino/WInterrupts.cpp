@@ -21,13 +21,17 @@
 
 #include "interrupt.h"
 
-void attachInterrupt(uint32_t pin, callback_function_t callback, uint32_t mode)
+void attachInterruptArg(uint32_t pin, callback_arg_function_t callback, void *arg,
+                        void (*release)(void *arg), uint32_t mode)
 {
 #if !defined(HAL_EXTI_MODULE_DISABLED)
   uint32_t it_mode;
   PinName p = digitalPinToPinName(pin);
   GPIO_TypeDef *port = set_GPIO_Port_Clock(PY32_PORT(p));
   if (!port) {
+    if (release != NULL) {
+      release(arg);
+    }
     return;
   }
 
@@ -52,25 +56,34 @@ void attachInterrupt(uint32_t pin, callback_function_t callback, uint32_t mode)
   //pinF1_DisconnectDebug(p);
 #endif /* AIR32F1xx */
 
-  air_interrupt_enable(port, PY32_GPIO_PIN(p), callback, it_mode);
+  air_interrupt_enable_arg(port, PY32_GPIO_PIN(p), callback, arg, release, it_mode);
 #else
   UNUSED(pin);
   UNUSED(callback);
   UNUSED(mode);
+  if (release != NULL) {
+    release(arg);
+  }
 #endif
 }
 
-void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode)
+void attachInterruptArg(uint32_t pin, callback_arg_function_t callback, void *arg, uint32_t mode)
 {
-#if !defined(HAL_EXTI_MODULE_DISABLED)
-  callback_function_t _c = callback;
-  attachInterrupt(pin, _c, mode);
-#else
-  UNUSED(pin);
-  UNUSED(callback);
-  UNUSED(mode);
-#endif
+  attachInterruptArg(pin, callback, arg, NULL, mode);
+}
+
+static void callPlainInterrupt(void *arg)
+{
+  ((void (*)(void))arg)();
+}
 
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode)
+{
+  if (callback == NULL) {
+    detachInterrupt(pin);
+    return;
+  }
+  attachInterruptArg(pin, callPlainInterrupt, (void *)callback, NULL, mode);
 }
 
 void detachInterrupt(uint32_t pin)
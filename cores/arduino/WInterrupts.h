@@ -21,9 +21,36 @@
 
 #include <stdint.h>
 #include <functional>
+#include <type_traits>
 
 typedef std::function<void(void)> callback_function_t;
-void attachInterrupt(uint32_t pin, callback_function_t callback, uint32_t mode);
+// Interrupt callback with a context pointer, given back as its argument
+typedef void (*callback_arg_function_t)(void *arg);
+
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode);
+// callback(arg) is called, e.g. with the object that handles this pin.
+void attachInterruptArg(uint32_t pin, callback_arg_function_t callback, void *arg, uint32_t mode);
+// Same, release(arg) is called when the callback is replaced or detached.
+void attachInterruptArg(uint32_t pin, callback_arg_function_t callback, void *arg,
+                        void (*release)(void *arg), uint32_t mode);
 void detachInterrupt(uint32_t pin);
 
+// Any other callable (lambda capturing state, std::function) is kept in a
+// heap copy. Only compiled in by sketches that use it.
+inline void callInterruptFunction(void *arg)
+{
+  (*(callback_function_t *)arg)();
+}
+
+inline void deleteInterruptFunction(void *arg)
+{
+  delete (callback_function_t *)arg;
+}
+
+template <typename F, typename = typename std::enable_if<!std::is_convertible<F, void (*)(void)>::value>::type>
+void attachInterrupt(uint32_t pin, F callback, uint32_t mode)
+{
+  attachInterruptArg(pin, callInterruptFunction, new callback_function_t(callback), deleteInterruptFunction, mode);
+}
+
 #endif /* _WIRING_INTERRUPTS_ */
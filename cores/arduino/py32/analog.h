@@ -53,6 +53,24 @@ extern "C" {
 uint32_t get_adc_channel(PinName pin, uint32_t *bank);
 uint32_t get_adc_internal_channel(PinName pin);
 uint16_t adc_read_value(PinName pin, uint32_t resolution);
+uint8_t adc_read_multi(const PinName *pins, uint16_t *out, uint32_t count, uint32_t resolution);
+uint8_t adc_session_begin(uint32_t resolution);
+void adc_session_end(void);
+uint8_t adc_session_active(void);
+uint8_t adc_watchdog_start(PinName pin, uint16_t low, uint16_t high, void (*callback)(uint16_t value));
+uint8_t adc_watchdog_rearm(uint16_t low, uint16_t high);
+void adc_watchdog_stop(void);
+uint8_t adc_watchdog_active(void);
+uint8_t adc_watchdog_armed(void);
+uint16_t adc_watchdog_value(void);
+void adc_irq_handler(void);
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+uint8_t adc_stream_start(const PinName *pins, uint32_t count, uint32_t trigger,
+                         uint16_t *buffer, uint32_t length, void (*callback)(uint8_t half));
+void adc_stream_stop(void);
+uint8_t adc_stream_rewind(void);
+uint8_t adc_stream_active(void);
+#endif
 #endif
 #if defined(HAL_DAC_MODULE_ENABLED) && !defined(HAL_DAC_MODULE_ONLY)
 uint32_t get_dac_channel(PinName pin);
@@ -61,6 +79,7 @@ void dac_stop(PinName pin);
 #endif
 #if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
 void pwm_start(PinName pin, uint32_t clock_freq, uint32_t value, TimerCompareFormat_t resolution);
+uint8_t pwm_write_cached(PinName pin, uint32_t PWM_freq, uint32_t value, TimerCompareFormat_t resolution);
 void pwm_stop(PinName pin);
 #endif
 
@@ -0,0 +1,54 @@
+/*
+ *******************************************************************************
+ * Copyright (c) 2024, AirM2M
+ * All rights reserved.
+ *
+ * This software component is licensed by AirM2M under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ *******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DMA_H
+#define __DMA_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "py32_def.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef DMA_IRQ_PRIO
+#define DMA_IRQ_PRIO       1
+#endif
+#ifndef DMA_IRQ_SUBPRIO
+#define DMA_IRQ_SUBPRIO    0
+#endif
+
+#if defined(DMA1_Channel7_BASE)
+#define DMA_CHANNEL_NUM    7
+#else
+#define DMA_CHANNEL_NUM    3
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+/* Channels are shared by the whole core: a driver claims a free channel for
+ * its handle, then uses the regular HAL_DMA_* API on it. The IRQ handlers of
+ * this module forward to HAL_DMA_IRQHandler() of the owning handle. */
+DMA_Channel_TypeDef *dma_channel_claim(DMA_HandleTypeDef *hdma);
+void dma_channel_release(DMA_HandleTypeDef *hdma);
+
+#endif /* HAL_DMA_MODULE_ENABLED && DMA1_BASE */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DMA_H */
+
+/************************ (C) COPYRIGHT AirM2M *****END OF FILE****/
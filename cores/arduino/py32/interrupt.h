@@ -59,15 +59,12 @@
     #define EXTI_IRQ_SUBPRIO    0
   #endif
 
-  #ifdef __cplusplus
-    #include <functional>
-
-    typedef std::function<void(void)> callback_function_t;
-    void air_interrupt_enable(GPIO_TypeDef *port, uint16_t pin, callback_function_t callback, uint32_t mode);
-  #endif
-
   /* Exported functions ------------------------------------------------------- */
   void air_interrupt_enable(GPIO_TypeDef *port, uint16_t pin, void (*callback)(void), uint32_t mode);
+  /* callback(arg) is called from the interrupt. release(arg), if not NULL, is
+   * called when the callback is replaced or the interrupt disabled. */
+  void air_interrupt_enable_arg(GPIO_TypeDef *port, uint16_t pin, void (*callback)(void *arg), void *arg,
+                                void (*release)(void *arg), uint32_t mode);
   void air_interrupt_disable(GPIO_TypeDef *port, uint16_t pin);
 #endif /* !HAL_EXTI_MODULE_DISABLED */
 
@@ -201,6 +201,116 @@ extern "C"
     return value;
   }
 
+  bool analogReadMulti(const uint32_t *pins, uint16_t *out, size_t n)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+    PinName names[32];
+    if ((pins == NULL) || (out == NULL) || (n == 0) || (n > 32))
+    {
+      return false;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+      names[i] = analogInputToPinName(pins[i]);
+      if (names[i] == NC)
+      {
+        return false;
+      }
+    }
+    if (!adc_read_multi(names, out, n, _internalReadResolution))
+    {
+      return false;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+      out[i] = mapResolution(out[i], _internalReadResolution, _readResolution);
+    }
+    return true;
+#else
+    UNUSED(pins);
+    UNUSED(out);
+    UNUSED(n);
+    return false;
+#endif
+  }
+
+  bool analogReadBegin(void)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+    return adc_session_begin(_internalReadResolution) != 0;
+#else
+    return false;
+#endif
+  }
+
+  void analogReadEnd(void)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+    adc_session_end();
+#endif
+  }
+
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+  static void (*_watchdogCallback)(uint32_t value) = NULL;
+
+  static void analogWatchdogTrip(uint16_t value)
+  {
+    if (_watchdogCallback != NULL)
+    {
+      _watchdogCallback(mapResolution(value, 12, _readResolution));
+    }
+  }
+#endif
+
+  bool analogWatchdogBegin(uint32_t ulPin, uint32_t low, uint32_t high, void (*callback)(uint32_t value))
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+    PinName p = analogInputToPinName(ulPin);
+    if (p == NC)
+    {
+      return false;
+    }
+    _watchdogCallback = callback;
+    return adc_watchdog_start(p, mapResolution(low, _readResolution, 12),
+                              mapResolution(high, _readResolution, 12), analogWatchdogTrip) != 0;
+#else
+    UNUSED(ulPin);
+    UNUSED(low);
+    UNUSED(high);
+    UNUSED(callback);
+    return false;
+#endif
+  }
+
+  bool analogWatchdogRearm(uint32_t low, uint32_t high)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+    return adc_watchdog_rearm(mapResolution(low, _readResolution, 12),
+                              mapResolution(high, _readResolution, 12)) != 0;
+#else
+    UNUSED(low);
+    UNUSED(high);
+    return false;
+#endif
+  }
+
+  bool analogWatchdogArmed(void)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+    return adc_watchdog_armed() != 0;
+#else
+    return false;
+#endif
+  }
+
+  void analogWatchdogEnd(void)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+    adc_watchdog_stop();
+    _watchdogCallback = NULL;
+#endif
+  }
+
   uint32_t analogReadMillivolts(uint32_t ulPin)
   {
     uint32_t value = 0;
@@ -272,6 +382,111 @@ extern "C"
 #endif
   }
 
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY) && defined(TEMPSENSOR_CAL1_ADDR)
+  // Factory calibration of the temperature sensor, loaded once
+  static bool _calLoaded = false;
+  static int32_t _tsCal1 = 0;
+  static int32_t _tsSlopeQ16 = 0; // centi-degrees per sensor count at TEMPSENSOR_CAL_VREFANALOG
+
+  // Latest VCC/temperature, refreshed by conversions or analogInternalUpdate()
+  static volatile uint32_t _vccMillivolts = 0;
+  static volatile int32_t _temperatureCentiDeg = 0;
+  static volatile uint32_t _internalStamp = 0;
+  static volatile bool _internalValid = false;
+  static uint32_t _internalMaxAge = 0;
+
+  static void internalCalibrationLoad(void)
+  {
+    int32_t cal1 = *TEMPSENSOR_CAL1_ADDR & 0xFFF;
+    int32_t cal2 = *TEMPSENSOR_CAL2_ADDR & 0xFFF;
+
+    _tsCal1 = cal1;
+    if (cal2 > cal1)
+    {
+      _tsSlopeQ16 = ((TEMPSENSOR_CAL2_TEMP - TEMPSENSOR_CAL1_TEMP) * 100 * 65536) / (cal2 - cal1);
+    }
+    _calLoaded = true;
+  }
+
+  static void internalRefresh(void)
+  {
+    if (_internalValid && ((uint32_t)(millis() - _internalStamp) < _internalMaxAge))
+    {
+      return;
+    }
+    // A running session keeps its resolution: reading at another one would
+    // tear it down and recalibrate, so read at the session's and scale to 12
+    uint32_t res = adc_session_active() ? (uint32_t)_internalReadResolution : 12;
+    uint32_t vrefRaw = mapResolution(adc_read_value(PADC_VREF, res), res, 12);
+    uint32_t tempRaw = mapResolution(adc_read_value(PADC_TEMP, res), res, 12);
+    // 0 when the ADC is busy with a background stream: keep the last values
+    if ((vrefRaw != 0) && (tempRaw != 0))
+    {
+      analogInternalUpdate(vrefRaw, tempRaw);
+    }
+  }
+#endif
+
+  void analogInternalUpdate(uint32_t vrefRaw, uint32_t tempRaw)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY) && defined(TEMPSENSOR_CAL1_ADDR)
+    if (vrefRaw == 0)
+    {
+      return;
+    }
+    if (!_calLoaded)
+    {
+      internalCalibrationLoad();
+    }
+
+    uint32_t vcc = (VREFINT_CAL_VREF * 4095U + vrefRaw / 2) / vrefRaw;
+
+    // Sensor count as it would read with the calibration supply, Q8:
+    // tempRaw * vcc / TEMPSENSOR_CAL_VREFANALOG, with a Q24 reciprocal.
+    const uint32_t recipQ24 = ((1UL << 24) + TEMPSENSOR_CAL_VREFANALOG / 2) / TEMPSENSOR_CAL_VREFANALOG;
+    int32_t tsQ8 = (int32_t)(((uint64_t)tempRaw * vcc * recipQ24) >> 16);
+    int32_t centi = TEMPSENSOR_CAL1_TEMP * 100 +
+                    (int32_t)(((int64_t)(tsQ8 - (_tsCal1 << 8)) * _tsSlopeQ16) >> 24);
+
+    _vccMillivolts = vcc;
+    _temperatureCentiDeg = (_tsSlopeQ16 != 0) ? centi : 0;
+    _internalStamp = millis();
+    _internalValid = true;
+#else
+    UNUSED(vrefRaw);
+    UNUSED(tempRaw);
+#endif
+  }
+
+  void analogInternalMaxAge(uint32_t ms)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY) && defined(TEMPSENSOR_CAL1_ADDR)
+    _internalMaxAge = ms;
+#else
+    UNUSED(ms);
+#endif
+  }
+
+  uint32_t readVccMillivolts(void)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY) && defined(TEMPSENSOR_CAL1_ADDR)
+    internalRefresh();
+    return _vccMillivolts;
+#else
+    return 0;
+#endif
+  }
+
+  int32_t readTemperatureCentiDeg(void)
+  {
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY) && defined(TEMPSENSOR_CAL1_ADDR)
+    internalRefresh();
+    return _temperatureCentiDeg;
+#else
+    return 0;
+#endif
+  }
+
   void analogOutputInit(void)
   {
   }
@@ -288,6 +503,14 @@ extern "C"
     PinName p = digitalPinToPinName(ulPin);
     if (p != NC)
     {
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+      // Fast path: PWM already running with the same frequency and resolution
+      if (pwm_write_cached(p, _writeFreq, mapResolution(ulValue, _writeResolution, _internalWriteResolution),
+                           (TimerCompareFormat_t)_internalWriteResolution))
+      {
+        return;
+      }
+#endif
 #if defined(HAL_DAC_MODULE_ENABLED) && !defined(HAL_DAC_MODULE_ONLY)
       if (pin_in_pinmap(p, PinMap_DAC))
       {
@@ -74,6 +74,59 @@ extern void analogWrite(uint32_t ulPin, uint32_t ulValue) ;
  */
 extern uint32_t analogRead(uint32_t ulPin) ;
 
+/*
+ * \brief Reads several analog pins with a single ADC setup: the sequencer
+ * converts all channels in one scan. Values are stored in out in the order
+ * of pins, in the analogReadResolution() scale. The sampling time is common
+ * to all channels of the scan; it is the longer internal-channel one when
+ * the batch includes AVREF or ATEMP. At most 32 pins.
+ *
+ * \return true if all pins were converted.
+ */
+extern bool analogReadMulti(const uint32_t *pins, uint16_t *out, size_t n);
+
+/*
+ * \brief Keep the ADC enabled and calibrated between analogRead() calls.
+ * Each read then only selects the channel and runs one conversion.
+ * AnalogScanner::begin() fails while the session is running.
+ *
+ * \return true if the ADC session is running.
+ */
+extern bool analogReadBegin(void);
+
+/*
+ * \brief Stop the session started by analogReadBegin() and power the ADC down.
+ * analogRead() still works afterwards, with a full ADC setup per call.
+ */
+extern void analogReadEnd(void);
+
+/*
+ * \brief Convert a pin continuously in the background and call callback from
+ * the ADC interrupt as soon as a conversion falls outside [low, high].
+ * Thresholds and values use the analogReadResolution() scale. The watchdog is
+ * one-shot: re-arm it with analogWatchdogRearm() after it tripped. Meanwhile
+ * analogRead() of the watched pin returns the latest conversion at no cost,
+ * other pins read 0.
+ *
+ * \return true if the watchdog is running.
+ */
+extern bool analogWatchdogBegin(uint32_t ulPin, uint32_t low, uint32_t high, void (*callback)(uint32_t value));
+
+/*
+ * \brief Arm the watchdog again, possibly with new thresholds.
+ */
+extern bool analogWatchdogRearm(uint32_t low, uint32_t high);
+
+/*
+ * \brief true while the watchdog is armed, false once it tripped.
+ */
+extern bool analogWatchdogArmed(void);
+
+/*
+ * \brief Stop the background conversions and power the ADC down.
+ */
+extern void analogWatchdogEnd(void);
+
 /**
  * @brief Read the value from the specified analog pin in millivolts.
  * 
@@ -106,6 +159,33 @@ extern int32_t analogReadTempSensor();
  */
 extern int32_t analogReadVoltage(int32_t VRef, uint32_t pin);
 
+/*
+ * \brief Supply voltage in millivolts, from VREFINT.
+ * Integer math only. See analogInternalMaxAge() to serve cached values.
+ */
+extern uint32_t readVccMillivolts(void);
+
+/*
+ * \brief Die temperature in 1/100 degC, from the factory calibration of the
+ * temperature sensor (read from flash once) and the current supply voltage.
+ * Returns 0 if the part has no valid calibration.
+ */
+extern int32_t readTemperatureCentiDeg(void);
+
+/*
+ * \brief Results younger than ms are returned by readVccMillivolts() and
+ * readTemperatureCentiDeg() without any conversion. Default is 0: convert on
+ * every call.
+ */
+extern void analogInternalMaxAge(uint32_t ms);
+
+/*
+ * \brief Feed raw 12-bit VREFINT and temperature sensor samples, e.g. from an
+ * AnalogScanner block callback scanning AVREF and ATEMP. Safe to call from an
+ * interrupt. Combined with analogInternalMaxAge(), reads then cost a few cycles.
+ */
+extern void analogInternalUpdate(uint32_t vrefRaw, uint32_t tempRaw);
+
 /*
  * \brief Set the resolution of analogRead return values. Default is 10 bits (range from 0 to 1023).
  *
@@ -0,0 +1,32 @@
+
+#include <EasyInterval.h>
+
+// Intervals driven by one hardware timer instead of millis() polling
+TimerWheel wheel;
+
+EasyInterval blink(500);      // 0.5s, polled with check()
+EasyInterval report(2000);    // 2s, callback from wheel.poll()
+
+void printReport(void*) {
+  Serial.println("Report");
+}
+
+void setup() {
+  Serial.begin(9600);
+  pinMode(LED_BUILTIN, OUTPUT);
+
+  if (!wheel.begin(TIM1, 1000)) {  // 1 ms ticks
+    Serial.println("TimerWheel: no timer, using millis()");
+    return;                   // check() keeps polling millis()
+  }
+  blink.attach(wheel);
+  report.attach(wheel, printReport);
+}
+
+void loop() {
+  wheel.poll();               // runs deferred callbacks
+
+  if (blink.check()) {
+    digitalToggle(LED_BUILTIN);
+  }
+}
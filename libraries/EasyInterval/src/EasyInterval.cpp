@@ -10,6 +10,13 @@ EasyInterval::EasyInterval(unsigned long ms) {
 
 bool EasyInterval::check() {
   if (!enabled) return false;
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+  if (wheel) {
+    if (!fired) return false;
+    fired = 0;
+    return true;
+  }
+#endif
   unsigned long now = millis();
   if (now - lastTime >= intervalMs) {
     lastTime = now;
@@ -29,6 +36,15 @@ bool EasyInterval::expired() {
 
 bool EasyInterval::checkCatchUp() {
   if (!enabled) return false;
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+  if (wheel) {
+    noInterrupts();
+    bool due = (fired != 0);
+    if (due) fired--;
+    interrupts();
+    return due;
+  }
+#endif
   unsigned long now = millis();
   if (now - lastTime >= intervalMs) {
     lastTime += intervalMs;
@@ -49,10 +65,16 @@ bool EasyInterval::running() {
 void EasyInterval::interval(unsigned long ms) {
   intervalMs = ms;
   phasedMode = false;
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+  if (wheel) arm();
+#endif
 }
 
 void EasyInterval::reset() {
   lastTime = millis();
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+  if (wheel) arm();
+#endif
 }
 
 unsigned long EasyInterval::get() {
@@ -71,9 +93,72 @@ void EasyInterval::setPhases(unsigned long ms1, unsigned long ms2) {
   intervalMs = ms1;
   phasedMode = true;
   lastTime = millis();
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+  if (wheel) arm();
+#endif
 }
 
 // Returns the current phase (0 or 1)
 uint8_t EasyInterval::phase() {
   return currentPhase;
 }
+
+void EasyInterval::enable() {
+  enabled = true;
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+  if (wheel && !wheelTimer.active()) {
+    lastTime = millis();
+    arm();
+  }
+#endif
+}
+
+void EasyInterval::disable() {
+  enabled = false;
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+  if (wheel) wheel->cancel(wheelTimer);
+#endif
+}
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+void EasyInterval::attach(TimerWheel& w, void (*cb)(void*), void* arg, bool inInterrupt) {
+  detach();
+  wheel = &w;
+  callback = cb;
+  callbackArg = arg;
+  // Without a callback only the flag is set: do it in the interrupt.
+  callbackInInterrupt = inInterrupt || (cb == nullptr);
+  lastTime = millis();
+  if (enabled) arm();
+}
+
+void EasyInterval::detach() {
+  if (!wheel) return;
+  wheel->cancel(wheelTimer);
+  wheel = nullptr;
+  fired = 0;
+}
+
+// (Re)start the wheel timer for the current interval or phase.
+void EasyInterval::arm() {
+  fired = 0;
+  if (!enabled) return;
+  uint32_t ticks = wheel->msToTicks(intervalMs);
+  if (ticks == 0) ticks = 1;
+  // Phases differ in length: one shot each, re-armed in onWheel().
+  wheel->start(wheelTimer, ticks, phasedMode ? 0 : ticks, onWheel, this, callbackInInterrupt);
+}
+
+void EasyInterval::onWheel(void* self) {
+  EasyInterval* e = (EasyInterval*)self;
+  e->lastTime = millis();
+  if (e->fired != 0xFF) e->fired++;
+  if (e->phasedMode) {
+    e->currentPhase = 1 - e->currentPhase;
+    e->intervalMs = e->phaseDurations[e->currentPhase];
+    uint32_t ticks = e->wheel->msToTicks(e->intervalMs);
+    e->wheel->start(e->wheelTimer, ticks ? ticks : 1, 0, onWheel, e, e->callbackInInterrupt);
+  }
+  if (e->callback) e->callback(e->callbackArg);
+}
+#endif
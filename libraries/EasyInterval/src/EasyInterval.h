@@ -17,8 +17,28 @@ private:
     unsigned long phaseDurations[2] = {0, 0};
     uint8_t currentPhase = 0;
 
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+    // TimerWheel mode
+    TimerWheel* wheel = nullptr;
+    WheelTimer wheelTimer;
+    volatile uint8_t fired = 0;
+    void (*callback)(void*) = nullptr;
+    void* callbackArg = nullptr;
+    bool callbackInInterrupt = false;
+
+    void arm();
+    static void onWheel(void* self);
+#endif
+
 public:
     EasyInterval(unsigned long ms = 0);
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+    // An attached interval is linked into the wheel: leave it on destruction,
+    // and never copy it (the copy would share the linked node).
+    ~EasyInterval() { detach(); }
+    EasyInterval(const EasyInterval&) = delete;
+    EasyInterval& operator=(const EasyInterval&) = delete;
+#endif
     bool check();
     bool expired();
     bool checkCatchUp();
@@ -30,9 +50,18 @@ public:
     uint8_t phase();
 
     // Enable/disable methods
-    void enable()   { enabled = true; }
-    void disable()  { enabled = false; }
+    void enable();
+    void disable();
     bool isEnabled() const { return enabled; }
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+    // Run on a TimerWheel instead of polling millis(): check() only reads a
+    // flag, and callback(arg), if given, is called at each interval, from
+    // the timer interrupt or from wheel.poll().
+    void attach(TimerWheel& wheel, void (*callback)(void*) = nullptr, void* arg = nullptr,
+                bool inInterrupt = false);
+    void detach();
+#endif
 };
 
 #endif
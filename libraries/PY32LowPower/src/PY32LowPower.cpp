@@ -71,12 +71,18 @@ extern "C" void LPTIM1_IRQHandler(void) {
         __HAL_LPTIM_CLEAR_FLAG(&hlptim, LPTIM_FLAG_ARRM);
 
         SystemClock_Config();
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+        HardwareTimer::clockChanged();
+#endif
 
     }
 }
 
 void PY32LowPower::exitSleep(void) {
     SystemClock_Config();
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
+    HardwareTimer::clockChanged();
+#endif
 }
 
 
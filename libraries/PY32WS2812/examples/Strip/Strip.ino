@@ -0,0 +1,19 @@
+#include <PY32WS2812.h>
+
+// 100 LEDs on PA8 (TIM1_CH1), a red dot running along the strip
+PY32WS2812 strip;
+uint8_t pixels[100 * 3];      // R, G, B
+
+void setup() {
+  strip.begin(PA8);
+}
+
+void loop() {
+  static size_t led = 0;
+
+  memset(pixels, 0, sizeof(pixels));
+  pixels[led * 3] = 255;
+  strip.show(pixels, 100);    // returns while the frame is sent
+  led = (led + 1) % 100;
+  delay(20);
+}
@@ -0,0 +1,95 @@
+#include "Arduino.h"
+#include "PY32WS2812.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && \
+    defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+
+// Bit period 1.25 us, high time 0.4 us for a 0 and 0.8 us for a 1.
+static const uint32_t kBitRate = 800000;
+static const uint32_t kZeroRate = 2500000;
+static const uint32_t kOneRate = 1250000;
+static const uint32_t kLatchMicros = 300;
+
+bool PY32WS2812::begin(uint32_t pin)
+{
+  end();
+  if (!wave_.begin(pin, 0, 2)) {
+    return false;
+  }
+  uint32_t rate = wave_.tickRate();
+  uint32_t period = (rate + kBitRate / 2) / kBitRate;
+  if ((period < 8) || (period > 0xFFFF)) {
+    // Below ~6.4 MHz the high times cannot be told apart.
+    wave_.end();
+    return false;
+  }
+  wave_.setPeriod((uint16_t)period);
+  zero_ = (uint16_t)((rate + kZeroRate / 2) / kZeroRate);
+  one_ = (uint16_t)((rate + kOneRate / 2) / kOneRate);
+  latching_ = false;
+  return true;
+}
+
+void PY32WS2812::end()
+{
+  wave_.end();
+  remaining_ = 0;
+  latching_ = false;
+}
+
+bool PY32WS2812::busy()
+{
+  if (wave_.busy()) {
+    return true;
+  }
+  if (latching_ && ((micros() - doneAt_) < kLatchMicros)) {
+    return true;
+  }
+  latching_ = false;
+  return false;
+}
+
+bool PY32WS2812::show(const uint8_t* pixels, size_t count)
+{
+  if ((pixels == nullptr) || (count == 0) || (zero_ == 0)) {
+    return false;
+  }
+  while (busy()) {
+  }
+  pixels_ = pixels;
+  remaining_ = count;
+  return wave_.stream(buffer_, sizeof(buffer_) / sizeof(buffer_[0]), refill, this, done);
+}
+
+size_t PY32WS2812::refill(uint16_t* half, size_t count, void* context)
+{
+  PY32WS2812* self = (PY32WS2812*)context;
+  const uint16_t zero = self->zero_;
+  const uint16_t one = self->one_;
+  size_t filled = 0;
+
+  while ((self->remaining_ != 0) && (filled + 24 <= count)) {
+    const uint8_t* pixel = self->pixels_;
+    const uint8_t grb[3] = { pixel[1], pixel[0], pixel[2] };
+
+    for (uint8_t c = 0; c < 3; c++) {
+      uint8_t value = grb[c];
+      for (uint8_t mask = 0x80; mask != 0; mask >>= 1) {
+        half[filled++] = (value & mask) ? one : zero;
+      }
+    }
+    self->pixels_ = pixel + 3;
+    self->remaining_--;
+  }
+  return filled;
+}
+
+void PY32WS2812::done(void* context)
+{
+  PY32WS2812* self = (PY32WS2812*)context;
+
+  self->doneAt_ = micros();
+  self->latching_ = true;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Arduino.h"
+
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY) && \
+    defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+
+#include "TimerWaveform.h"
+
+// Pixels encoded per half of the rolling DMA buffer. Each one costs 2 x 48
+// bytes of RAM; the encoder must fill a half while the other is being sent
+// (30 us per pixel), so raise it at low CPU clocks.
+#ifndef PY32WS2812_LEDS_PER_HALF
+#define PY32WS2812_LEDS_PER_HALF 2
+#endif
+
+// WS2812/SK6812 (800 kHz) LED strip on a timer output pin.
+//
+// Each data bit is one timer period whose high time (0.4 or 0.8 us) comes
+// from a compare value streamed by DMA (TimerWaveform::stream()). Pixels are
+// encoded into a small rolling buffer from the half-transfer interrupts, so
+// RAM use does not grow with the strip length. The CPU stays free, with
+// interrupts enabled, while a frame is sent.
+class PY32WS2812 {
+public:
+  // pin: a timer channel output (PinMap_TIM) of a timer with DMA.
+  bool begin(uint32_t pin);
+  void end();
+
+  // Send count pixels of 3 bytes in R, G, B order (GRB on the wire). Waits
+  // for the previous frame and its latch time, then returns while the frame
+  // is sent in the background: pixels must stay unchanged until !busy().
+  bool show(const uint8_t* pixels, size_t count);
+
+  // True while sending, and during the 300 us latch time after a frame.
+  bool busy();
+
+private:
+  static size_t refill(uint16_t* half, size_t count, void* context);
+  static void done(void* context);
+
+  TimerWaveform wave_;
+  uint16_t buffer_[2 * 24 * PY32WS2812_LEDS_PER_HALF];
+  uint16_t zero_ = 0;
+  uint16_t one_ = 0;
+
+  const uint8_t* pixels_ = nullptr;
+  volatile size_t remaining_ = 0;
+  volatile uint32_t doneAt_ = 0;
+  volatile bool latching_ = false;
+};
+
+#endif
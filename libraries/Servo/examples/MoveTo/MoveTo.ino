@@ -0,0 +1,33 @@
+/* MoveTo
+ Smooth background moves with Servo::moveTo() and Servo::moveSynchronized().
+ The motion profile runs in the servo timer interrupt: loop() is free,
+ and the servos arrive together.
+ This example code is in the public domain.
+*/
+
+#include <Servo.h>
+
+Servo pan;   // on a timer channel pin: hardware PWM
+Servo tilt;
+
+Servo *const both[] = { &pan, &tilt };
+
+void setup() {
+  pan.attach(PA6);
+  tilt.attach(PA7);
+}
+
+void loop() {
+  // one servo: up to 1000 us/s (about 100 degrees/s), 2000 us/s^2 ramps
+  pan.moveTo(180, 1000, 2000);
+  while (pan.moving()) {
+    // free for other work
+  }
+
+  // two servos, S-curve, starting and arriving together
+  const int home[] = { 0, 90 };
+  Servo::moveSynchronized(both, home, 2, 1500, 3000, SERVO_SCURVE);
+  while (Servo::anyMoving()) {
+  }
+  delay(500);
+}
@@ -25,6 +25,9 @@
 
   Note that analogWrite of PWM on pins associated with the timer are
   disabled when the first servo is attached.
+  On STM32/PY32, a servo on a pin with a free timer channel is driven by
+  that channel (PWM at REFRESH_INTERVAL, no interrupt); other pins are
+  pulsed in sequence from the TIMER_SERVO interrupt.
   Timers are seized as needed in groups of 12 servos - 24 servos use two
   timers, 48 servos will use four.
   The sequence used to seize timers is defined in timers.h
@@ -38,6 +41,7 @@
     default min is 544, max is 2400
 
     write()     - Sets the servo angle in degrees.  (invalid angle that is valid as pulse in microseconds is treated as microseconds)
+    moveTo()    - Moves to an angle or pulse width in the background, with a velocity and acceleration limit.
     writeMicroseconds() - Sets the servo pulse width in microseconds
     read()      - Gets the last written servo pulse width as an angle between 0 and 180.
     readMicroseconds()   - Gets the last written servo pulse width in microseconds. (was read_us() in first release)
@@ -97,8 +101,15 @@ typedef struct  {
 typedef struct {
   ServoPin_t Pin;
   volatile unsigned int ticks;
+  uint8_t channel;        // timer channel driving the pin, 0 if pulsed by the sequencer
+  uint8_t timerIndex;     // index of that timer
 } servo_t;
 
+typedef enum {
+  SERVO_TRAPEZOID,        // constant acceleration, cruise, constant deceleration
+  SERVO_SCURVE            // smooth acceleration (quintic), no jerk at the ends
+} ServoProfile_t;
+
 class Servo {
   public:
     Servo();
@@ -110,7 +121,19 @@ class Servo {
     int read();                        // returns current pulse width as an angle between 0 and 180 degrees
     int readMicroseconds();            // returns current pulse width in microseconds for this servo (was read_us() in first release)
     bool attached();                   // return true if this servo is attached, otherwise false
+    // Move to value (angle or microseconds, as write()) in the background, one step per refresh interval.
+    // maxVelocity in microseconds per second, accel in microseconds per second squared (0: no ramp).
+    void moveTo(int value, unsigned int maxVelocity, unsigned int accel = 0, ServoProfile_t profile = SERVO_TRAPEZOID);
+    bool moving();                     // true until the last moveTo() has reached its target
+    void stop();                       // stop the move where it is
+    // Move count servos so that they all start and arrive together, at the pace of the slowest one.
+    static void moveSynchronized(Servo *const servos[], const int values[], uint8_t count,
+                                 unsigned int maxVelocity, unsigned int accel = 0, ServoProfile_t profile = SERVO_TRAPEZOID);
+    static bool anyMoving();           // true while any servo is moving
   private:
+    int toMicroseconds(int value);     // angle or pulse width to a pulse width within min..max
+    uint32_t planMove(int target, unsigned int maxVelocity, unsigned int accel, ServoProfile_t profile); // returns frames
+
     uint8_t servoIndex;               // index into the channel data for this servo
     int8_t min;                       // minimum is this value times 4 added to MIN_PULSE_WIDTH
     int8_t max;                       // maximum is this value times 4 added to MAX_PULSE_WIDTH
@@ -22,23 +22,193 @@
 #include <Servo.h>
 #include <HardwareTimer.h>
 
-#if defined(HAL_TIM_MODULE_ENABLED) && defined(TIMER_SERVO) && !defined(HAL_TIM_MODULE_ONLY)
+#if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
 
 static servo_t servos[MAX_SERVOS];                         // static array of servo structures
-static volatile int8_t timerChannel[_Nbr_16timers] = {-1}; // counter for the servo being pulsed for each timer (or -1 if refresh interval)
-
-static HardwareTimer TimerServo(TIMER_SERVO);
 
 uint8_t ServoCount = 0;                                    // the total number of attached servos
 
 #define SERVO_MIN() (MIN_PULSE_WIDTH - this->min * 4)   // minimum value in uS for this servo
 #define SERVO_MAX() (MAX_PULSE_WIDTH - this->max * 4)   // maximum value in uS for this servo
 
-#define TIMER_ID(_timer) ((timer_id_e)(_timer))
-#define SERVO_TIMER(_timer_id)  ((timer16_Sequence_t)(_timer_id))
+// Timers driving servo pins from their compare channels, at REFRESH_INTERVAL
+typedef struct {
+  HardwareTimer *timer;
+  uint8_t users;     // attached servos on this timer
+  bool framed;       // update interrupt steps the moves of its servos
+} servoPwmTimer_t;
+
+static servoPwmTimer_t servoPwmTimers[TIMER_NUM];
+
+// Motion profile of a servo, advanced once per refresh interval (frame).
+// Position is start + distance * shape(u), u going from 0 to 1 in Q16.
+typedef struct {
+  volatile bool active;
+  uint8_t profile;
+  int16_t start;          // pulse width at the start, in uS
+  int16_t distance;       // signed, in uS
+  uint32_t frames;        // duration of the move
+  uint32_t frame;
+  uint32_t u;             // Q24
+  uint32_t du;            // Q24 per frame
+  uint32_t f;             // trapezoid: ramp duration / total, Q16 (0: no ramp)
+  uint32_t vp;            // trapezoid: peak velocity 1 / (1 - f), Q16
+  uint32_t c;             // trapezoid: ramp curvature vp / 2f, Q16
+} servoMove_t;
+
+static servoMove_t moves[MAX_SERVOS];
+static void ServoMoveFrame(bool sequenced, uint8_t timerIndex);
 
 /************ static functions common to all instances ***********************/
 
+/**
+  * @brief  Drive pin from its timer compare channel, PWM at REFRESH_INTERVAL.
+  *         All channels of a timer share its period, so the timer must be
+  *         free or already used by servos only.
+  * @param  servo : servo structure, timer index and channel are set on success
+  * @param  pin : Arduino pin
+  * @retval true if the pin is driven by its timer
+  */
+static bool ServoPwmAttach(servo_t *servo, int pin)
+{
+  PinName p = digitalPinToPinName(pin);
+
+  if (p == NC) {
+    return false;
+  }
+  TIM_TypeDef *tim = (TIM_TypeDef *)pinmap_peripheral(p, PinMap_TIM);
+  if (tim == NULL) {
+    return false;
+  }
+  uint32_t channel = PY32_PIN_CHANNEL(pinmap_function(p, PinMap_TIM));
+  uint32_t index = get_timer_index(tim);
+  if ((index == UNKNOWN_TIMER) || (channel < 1) || (channel > 4)) {
+    return false;
+  }
+  servoPwmTimer_t *pwm = &servoPwmTimers[index];
+  if (pwm->timer == NULL) {
+    if ((HardwareTimer_Handle[index] != NULL) && (HardwareTimer_Handle[index]->__this != NULL)) {
+      // Used by PWM, tone or the sequenced servos
+      return false;
+    }
+    pwm->timer = new HardwareTimer(tim);
+    pwm->timer->setOverflow(REFRESH_INTERVAL, MICROSEC_FORMAT);
+  }
+  pwm->users++;
+  servo->timerIndex = (uint8_t)index;
+  servo->channel = (uint8_t)channel;
+  return true;
+}
+
+static void ServoPwmDetach(servo_t *servo)
+{
+  servoPwmTimer_t *pwm = &servoPwmTimers[servo->timerIndex];
+  PinName p = digitalPinToPinName(servo->Pin.nbr);
+
+  pwm->timer->setMode(servo->channel, TIMER_OUTPUT_COMPARE_FORCED_INACTIVE, p);
+  servo->channel = 0;
+  if (--pwm->users == 0) {
+    delete pwm->timer;
+    pwm->timer = NULL;
+    pwm->framed = false;
+  }
+}
+
+// Set the pulse width of a servo, in uS
+static void ServoSetPulse(uint8_t index, unsigned int value)
+{
+  servos[index].ticks = value;
+  if (servos[index].channel != 0) {
+    // Preloaded: the new width starts with the next period
+    servoPwmTimers[servos[index].timerIndex].timer->setCaptureCompare(servos[index].channel, value, MICROSEC_COMPARE_FORMAT);
+  }
+}
+
+static void ServoPwmFrameCallback(void *arg)
+{
+  ServoMoveFrame(false, (uint8_t)((servoPwmTimer_t *)arg - servoPwmTimers));
+}
+
+static uint32_t isqrt64(uint64_t x)
+{
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > x) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (x >= root + bit) {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+// Smallest n with n * n >= x
+static uint32_t isqrt64Up(uint64_t x)
+{
+  uint32_t root = isqrt64(x);
+  return ((uint64_t)root * root < x) ? root + 1 : root;
+}
+
+// Normalized position 0..1 (Q16) at normalized time u (Q16)
+static uint32_t ServoMoveShape(const servoMove_t *m, uint32_t u)
+{
+  if (m->profile == SERVO_SCURVE) {
+    // 10u^3 - 15u^4 + 6u^5: zero velocity and acceleration at both ends
+    uint32_t u2 = (u * u) >> 16;
+    uint32_t u3 = (u2 * u) >> 16;
+    uint32_t inner = 6 * u2 - 15 * u + 10 * 65536;
+    return (uint32_t)(((uint64_t)u3 * inner) >> 16);
+  }
+  if (m->f == 0) {
+    return u;
+  }
+  if (u < m->f) {
+    return (uint32_t)(((((uint64_t)m->c * u) >> 16) * u) >> 16);
+  }
+  if (u > 65536 - m->f) {
+    uint32_t w = 65536 - u;
+    return 65536 - (uint32_t)(((((uint64_t)m->c * w) >> 16) * w) >> 16);
+  }
+  return (uint32_t)(((uint64_t)m->vp * (u - m->f / 2)) >> 16);
+}
+
+// One frame of every moving servo of the sequencer or of a PWM timer
+static void ServoMoveFrame(bool sequenced, uint8_t timerIndex)
+{
+  for (uint8_t i = 0; i < ServoCount; i++) {
+    servoMove_t *m = &moves[i];
+    if (!m->active || ((servos[i].channel == 0) != sequenced) ||
+        (!sequenced && (servos[i].timerIndex != timerIndex))) {
+      continue;
+    }
+    int32_t value;
+    if (++m->frame >= m->frames) {
+      value = m->start + m->distance;
+      m->active = false;
+    } else {
+      m->u += m->du;
+      value = m->start + ((m->distance * (int32_t)ServoMoveShape(m, m->u >> 8)) >> 16);
+    }
+    ServoSetPulse(i, value);
+  }
+}
+
+#if defined(TIMER_SERVO)
+
+static volatile int8_t timerChannel[_Nbr_16timers] = {-1}; // counter for the servo being pulsed for each timer (or -1 if refresh interval)
+
+static HardwareTimer TimerServo(TIMER_SERVO);
+
+#define TIMER_ID(_timer) ((timer_id_e)(_timer))
+#define SERVO_TIMER(_timer_id)  ((timer16_Sequence_t)(_timer_id))
+
 volatile uint32_t CumulativeCountSinceRefresh = 0;
 static void Servo_PeriodElapsedCallback()
 {
@@ -48,13 +218,17 @@ static void Servo_PeriodElapsedCallback()
   if (timerChannel[timer_id] < 0) {
     // Restart from 1st servo
     CumulativeCountSinceRefresh = 0;
+    ServoMoveFrame(true, 0);
   } else {
     if (timerChannel[timer_id] < ServoCount && servos[timerChannel[timer_id]].Pin.isActive == true) {
       digitalWrite(servos[timerChannel[timer_id]].Pin.nbr, LOW); // pulse this channel low if activated
     }
   }
 
-  timerChannel[timer_id]++;    // increment to the next channel
+  // increment to the next channel, skipping the ones driven by a timer channel
+  do {
+    timerChannel[timer_id]++;
+  } while (timerChannel[timer_id] < ServoCount && servos[timerChannel[timer_id]].channel != 0);
   if (timerChannel[timer_id] < ServoCount && timerChannel[timer_id] < SERVOS_PER_TIMER) {
     TimerServo.setOverflow(servos[timerChannel[timer_id]].ticks);
     CumulativeCountSinceRefresh += servos[timerChannel[timer_id]].ticks;
@@ -90,15 +264,17 @@ static void TimerServoInit()
 
 static bool isTimerActive()
 {
-  // returns true if any servo is active on this timer
+  // returns true if any sequenced servo is active on this timer
   for (uint8_t channel = 0; channel < SERVOS_PER_TIMER; channel++) {
-    if (servos[channel].Pin.isActive == true) {
+    if (servos[channel].Pin.isActive == true && servos[channel].channel == 0) {
       return true;
     }
   }
   return false;
 }
 
+#endif /* TIMER_SERVO */
+
 /****************** end of static functions ******************************/
 
 Servo::Servo()
@@ -119,8 +295,25 @@ uint8_t Servo::attach(int pin, int value)
 uint8_t Servo::attach(int pin, int min, int max, int value)
 {
   if (this->servoIndex < MAX_SERVOS) {
+    servo_t *servo = &servos[this->servoIndex];
+    if (servo->Pin.isActive == true) {
+      detach();
+    }
+    // Pins with a timer channel are driven by it, without interrupts
+    if (ServoPwmAttach(servo, pin)) {
+      servo->Pin.nbr = pin;
+      this->min  = (MIN_PULSE_WIDTH - min) / 4; //resolution of min/max is 4 uS
+      this->max  = (MAX_PULSE_WIDTH - max) / 4;
+      write(value);
+      HardwareTimer *timer = servoPwmTimers[servo->timerIndex].timer;
+      timer->setMode(servo->channel, TIMER_OUTPUT_COMPARE_PWM1, digitalPinToPinName(pin));
+      timer->resume();
+      servo->Pin.isActive = true;
+      return this->servoIndex;
+    }
+#if defined(TIMER_SERVO)
     pinMode(pin, OUTPUT);                                   // set servo pin to output
-    servos[this->servoIndex].Pin.nbr = pin;
+    servo->Pin.nbr = pin;
     write(value);
     // todo min/max check: abs(min - MIN_PULSE_WIDTH) /4 < 128
     this->min  = (MIN_PULSE_WIDTH - min) / 4; //resolution of min/max is 4 uS
@@ -129,21 +322,34 @@ uint8_t Servo::attach(int pin, int min, int max, int value)
     if (isTimerActive() == false) {
       TimerServoInit();
     }
-    servos[this->servoIndex].Pin.isActive = true;  // this must be set after the check for isTimerActive
+    servo->Pin.isActive = true;  // this must be set after the check for isTimerActive
+#else
+    return INVALID_SERVO;
+#endif
   }
   return this->servoIndex;
 }
 
 void Servo::detach()
 {
+  if (this->servoIndex >= MAX_SERVOS) {
+    return;
+  }
   servos[this->servoIndex].Pin.isActive = false;
+  moves[this->servoIndex].active = false;
 
+  if (servos[this->servoIndex].channel != 0) {
+    ServoPwmDetach(&servos[this->servoIndex]);
+    return;
+  }
+#if defined(TIMER_SERVO)
   if (isTimerActive() == false) {
     TimerServo.pause();
   }
+#endif
 }
 
-void Servo::write(int value)
+int Servo::toMicroseconds(int value)
 {
   // treat values less than 544 as angles in degrees (valid values in microseconds are handled as microseconds)
   if (value < MIN_PULSE_WIDTH) {
@@ -155,7 +361,17 @@ void Servo::write(int value)
 
     value = map(value, 0, 180, SERVO_MIN(), SERVO_MAX());
   }
-  writeMicroseconds(value);
+  if (value < SERVO_MIN()) {        // ensure pulse width is valid
+    value = SERVO_MIN();
+  } else if (value > SERVO_MAX()) {
+    value = SERVO_MAX();
+  }
+  return value;
+}
+
+void Servo::write(int value)
+{
+  writeMicroseconds(toMicroseconds(value));
 }
 
 void Servo::writeMicroseconds(int value)
@@ -169,8 +385,142 @@ void Servo::writeMicroseconds(int value)
       value = SERVO_MAX();
     }
 
-    servos[channel].ticks = value;
+    moves[channel].active = false;  // a write ends the move
+    ServoSetPulse(channel, value);
+  }
+}
+
+uint32_t Servo::planMove(int target, unsigned int maxVelocity, unsigned int accel, ServoProfile_t profile)
+{
+  servoMove_t *m = &moves[this->servoIndex];
+  int start = servos[this->servoIndex].ticks;
+  uint64_t d = (uint64_t)abs(target - start);
+  uint64_t v = maxVelocity;
+  uint64_t a = accel;
+  uint64_t frames;
+  uint32_t rate = 1000000UL / REFRESH_INTERVAL;   // frames per second
+
+  m->active = false;
+  __DMB();  // the interrupt is done with this move before it changes
+  m->profile = profile;
+  m->start = (int16_t)start;
+  m->distance = (int16_t)(target - start);
+  m->f = 0;
+  if ((d == 0) || (v == 0)) {
+    return 0;
+  }
+  if (profile == SERVO_SCURVE) {
+    // Peak velocity 1.875 d / T, peak acceleration 5.7735 d / T^2
+    frames = (d * rate * 15 + v * 8 - 1) / (v * 8);
+    if (a != 0) {
+      uint64_t ramp = isqrt64Up((d * rate * rate * 57735 + a * 10000 - 1) / (a * 10000));
+      frames = (ramp > frames) ? ramp : frames;
+    }
+  } else if (a == 0) {
+    frames = (d * rate + v - 1) / v;
+  } else if (d * a >= v * v) {
+    // Accelerate to v in v / a, cruise, decelerate: T = d / v + v / a
+    frames = (d * a * rate + v * v * rate + v * a - 1) / (v * a);
+    m->f = (uint32_t)(((v * v) << 16) / (d * a + v * v));
+  } else {
+    // v is never reached: T = 2 sqrt(d / a)
+    frames = isqrt64Up((4 * d * rate * rate + a - 1) / a);
+    m->f = 32768;
+  }
+  if (m->f != 0) {
+    m->vp = (uint32_t)((1ULL << 32) / (65536 - m->f));
+    m->c = (uint32_t)(((uint64_t)m->vp << 15) / m->f);
+  }
+  if (frames == 0) {
+    frames = 1;
+  }
+  return (frames > 0xFFFF) ? 0xFFFF : (uint32_t)frames;
+}
+
+// Start the planned move of servo index, over frames refresh intervals
+static void ServoMoveStart(uint8_t index, uint32_t frames)
+{
+  servoMove_t *m = &moves[index];
+
+  m->frames = frames;
+  m->frame = 0;
+  m->u = 0;
+  m->du = (1UL << 24) / frames;
+  if (servos[index].channel != 0) {
+    servoPwmTimer_t *pwm = &servoPwmTimers[servos[index].timerIndex];
+    if (!pwm->framed) {
+      pwm->timer->attachInterrupt(ServoPwmFrameCallback, pwm);
+      pwm->framed = true;
+    }
+  }
+  __DMB();
+  m->active = true;
+}
+
+void Servo::moveTo(int value, unsigned int maxVelocity, unsigned int accel, ServoProfile_t profile)
+{
+  if ((this->servoIndex >= MAX_SERVOS) || !servos[this->servoIndex].Pin.isActive) {
+    return;
   }
+  int target = toMicroseconds(value);
+  uint32_t frames = planMove(target, maxVelocity, accel, profile);
+
+  if (frames == 0) {
+    writeMicroseconds(target);
+    return;
+  }
+  ServoMoveStart(this->servoIndex, frames);
+}
+
+void Servo::moveSynchronized(Servo *const servos[], const int values[], uint8_t count,
+                             unsigned int maxVelocity, unsigned int accel, ServoProfile_t profile)
+{
+  uint32_t frames = 0;
+
+  // Every move is stretched to the longest one: same shape, lower peaks
+  for (uint8_t i = 0; i < count; i++) {
+    Servo *servo = servos[i];
+    if ((servo->servoIndex >= MAX_SERVOS) || !::servos[servo->servoIndex].Pin.isActive) {
+      continue;
+    }
+    uint32_t n = servo->planMove(servo->toMicroseconds(values[i]), maxVelocity, accel, profile);
+    frames = (n > frames) ? n : frames;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (uint8_t i = 0; i < count; i++) {
+    Servo *servo = servos[i];
+    if ((servo->servoIndex >= MAX_SERVOS) || !::servos[servo->servoIndex].Pin.isActive) {
+      continue;
+    }
+    if ((frames != 0) && (moves[servo->servoIndex].distance != 0)) {
+      ServoMoveStart(servo->servoIndex, frames);
+    }
+  }
+  __set_PRIMASK(primask);
+}
+
+bool Servo::moving()
+{
+  return (this->servoIndex < MAX_SERVOS) && moves[this->servoIndex].active;
+}
+
+void Servo::stop()
+{
+  if (this->servoIndex < MAX_SERVOS) {
+    moves[this->servoIndex].active = false;
+  }
+}
+
+bool Servo::anyMoving()
+{
+  for (uint8_t i = 0; i < ServoCount; i++) {
+    if (moves[i].active) {
+      return true;
+    }
+  }
+  return false;
 }
 
 int Servo::read() // return the value as degrees
@@ -192,23 +542,25 @@ int Servo::readMicroseconds()
 
 bool Servo::attached()
 {
-  return servos[this->servoIndex].Pin.isActive;
+  return (this->servoIndex < MAX_SERVOS) && servos[this->servoIndex].Pin.isActive;
 }
 
 #else
 
-#warning "TIMER_TONE or HAL_TIM_MODULE_ENABLED not defined"
+#warning "HAL_TIM_MODULE_ENABLED not defined"
 Servo::Servo() {}
-uint8_t Servo::attach(int pin)
+uint8_t Servo::attach(int pin, int value)
 {
   UNUSED(pin);
+  UNUSED(value);
   return 0;
 }
-uint8_t Servo::attach(int pin, int min, int max)
+uint8_t Servo::attach(int pin, int min, int max, int value)
 {
   UNUSED(pin);
   UNUSED(min);
   UNUSED(max);
+  UNUSED(value);
   return 0;
 }
 void Servo::detach() {}
@@ -228,8 +580,37 @@ int Servo::readMicroseconds()
 {
   return 0;
 }
-bool Servo::attached() {}
+bool Servo::attached()
+{
+  return false;
+}
+void Servo::moveTo(int value, unsigned int maxVelocity, unsigned int accel, ServoProfile_t profile)
+{
+  UNUSED(value);
+  UNUSED(maxVelocity);
+  UNUSED(accel);
+  UNUSED(profile);
+}
+bool Servo::moving()
+{
+  return false;
+}
+void Servo::stop() {}
+void Servo::moveSynchronized(Servo *const servos[], const int values[], uint8_t count,
+                             unsigned int maxVelocity, unsigned int accel, ServoProfile_t profile)
+{
+  UNUSED(servos);
+  UNUSED(values);
+  UNUSED(count);
+  UNUSED(maxVelocity);
+  UNUSED(accel);
+  UNUSED(profile);
+}
+bool Servo::anyMoving()
+{
+  return false;
+}
 
-#endif /* HAL_TIM_MODULE_ENABLED && TIMER_SERVO & !HAL_TIM_MODULE_ONLY */
+#endif /* HAL_TIM_MODULE_ENABLED && !HAL_TIM_MODULE_ONLY */
 
 #endif // ARDUINO_ARCH_STM32
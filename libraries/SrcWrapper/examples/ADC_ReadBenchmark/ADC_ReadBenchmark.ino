@@ -0,0 +1,39 @@
+// Compare analogRead() throughput with and without a persistent ADC session.
+//
+// Without analogReadBegin() every analogRead() runs a full ADC init,
+// calibration, conversion and deinit. With it, the ADC stays enabled and a
+// read is a channel select plus one conversion.
+
+static const uint32_t kSamples = 2000;
+static const uint32_t kPins[] = {PA0, PA1};
+
+static uint32_t samplesPerSecond() {
+  uint32_t sum = 0;
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < kSamples; i++) {
+    sum += analogRead(kPins[i & 1]);  // alternate channels
+  }
+  uint32_t elapsed = micros() - start;
+  (void)sum;
+  return (uint32_t)((uint64_t)kSamples * 1000000UL / elapsed);
+}
+
+void setup() {
+  Serial.begin(115200);
+}
+
+void loop() {
+  analogReadEnd();
+  uint32_t before = samplesPerSecond();
+
+  analogReadBegin();
+  uint32_t after = samplesPerSecond();
+  analogReadEnd();
+
+  Serial.print("analogRead: ");
+  Serial.print(before);
+  Serial.print(" samples/s, with analogReadBegin(): ");
+  Serial.print(after);
+  Serial.println(" samples/s");
+  delay(2000);
+}
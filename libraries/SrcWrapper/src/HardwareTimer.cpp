@@ -83,7 +83,9 @@ void HardwareTimer::setup(TIM_TypeDef *instance)
 
   // Initialize NULL callbacks
   for (int i = 0; i < TIMER_CHANNELS + 1 ; i++) {
-    callbacks[i] = NULL;
+    callbacks[i].function = NULL;
+    callbacks[i].arg = NULL;
+    callbacks[i].release = NULL;
   }
 
   // Initialize channel mode and complementary
@@ -189,7 +191,7 @@ void HardwareTimer::pauseChannel(uint32_t channel)
 void HardwareTimer::resume(void)
 {
   // Clear flag and enable IT
-  if (callbacks[0]) {
+  if (callbacks[0].function) {
     __HAL_TIM_CLEAR_FLAG(&(_timerObj.handle), TIM_FLAG_UPDATE);
     __HAL_TIM_ENABLE_IT(&(_timerObj.handle), TIM_IT_UPDATE);
 
@@ -365,7 +367,7 @@ void HardwareTimer::resumeChannel(uint32_t channel)
   }
 
   // Clear flag and enable IT
-  if (callbacks[channel]) {
+  if (callbacks[channel].function) {
     __HAL_TIM_CLEAR_FLAG(&(_timerObj.handle), interrupt);
     __HAL_TIM_ENABLE_IT(&(_timerObj.handle), interrupt);
   }
@@ -404,7 +406,7 @@ void HardwareTimer::resumeChannel(uint32_t channel)
         // Enable 2nd associated channel
         timAssociatedInputChannel = getAssociatedChannel(channel);
         LL_TIM_CC_EnableChannel(_timerObj.handle.Instance, getLLChannel(timAssociatedInputChannel));
-        if (callbacks[channel]) {
+        if (callbacks[channel].function) {
           __HAL_TIM_CLEAR_FLAG(&(_timerObj.handle), getIT(timAssociatedInputChannel));
           __HAL_TIM_ENABLE_IT(&(_timerObj.handle), getIT(timAssociatedInputChannel));
         }
@@ -468,7 +470,7 @@ uint32_t HardwareTimer::getOverflow(TimerFormat_t format)
   uint32_t return_value;
   switch (format) {
     case MICROSEC_FORMAT:
-      return_value = (uint32_t)(((ARR_RegisterValue + 1) * Prescalerfactor * 1000000.0) / getTimerClkFreq());
+      return_value = ticksToMicros((ARR_RegisterValue + 1) * Prescalerfactor);
       break;
     case HERTZ_FORMAT:
       return_value = (uint32_t)(getTimerClkFreq() / ((ARR_RegisterValue + 1) * Prescalerfactor));
@@ -504,7 +506,7 @@ void HardwareTimer::setOverflow(uint32_t overflow, TimerFormat_t format)
   // Remark: Hardware register correspond to period count-1. Example ARR register value 9 means period of 10 timer cycle
   switch (format) {
     case MICROSEC_FORMAT:
-      period_cyc = overflow * (getTimerClkFreq() / 1000000);
+      period_cyc = overflow * getTimerClkPerUs();
       Prescalerfactor = (period_cyc / 0x10000) + 1;
       LL_TIM_SetPrescaler(_timerObj.handle.Instance, Prescalerfactor - 1);
       PeriodTicks = period_cyc / Prescalerfactor;
@@ -548,7 +550,7 @@ uint32_t HardwareTimer::getCount(TimerFormat_t format)
   uint32_t return_value;
   switch (format) {
     case MICROSEC_FORMAT:
-      return_value = (uint32_t)((CNT_RegisterValue * Prescalerfactor * 1000000.0) / getTimerClkFreq());
+      return_value = ticksToMicros(CNT_RegisterValue * Prescalerfactor);
       break;
     case HERTZ_FORMAT:
       return_value = (uint32_t)(getTimerClkFreq() / (CNT_RegisterValue  * Prescalerfactor));
@@ -576,7 +578,7 @@ void HardwareTimer::setCount(uint32_t counter, TimerFormat_t format)
   uint32_t Prescalerfactor = LL_TIM_GetPrescaler(_timerObj.handle.Instance) + 1;
   switch (format) {
     case MICROSEC_FORMAT:
-      CNT_RegisterValue = ((counter * (getTimerClkFreq() / 1000000)) / Prescalerfactor);
+      CNT_RegisterValue = ((counter * getTimerClkPerUs()) / Prescalerfactor);
       break;
     case HERTZ_FORMAT:
       CNT_RegisterValue = (uint32_t)(getTimerClkFreq() / (counter * Prescalerfactor));
@@ -797,7 +799,7 @@ void HardwareTimer::setCaptureCompare(uint32_t channel, uint32_t compare, TimerC
 
   switch (format) {
     case MICROSEC_COMPARE_FORMAT:
-      CCR_RegisterValue = ((compare * (getTimerClkFreq() / 1000000)) / Prescalerfactor);
+      CCR_RegisterValue = ((compare * getTimerClkPerUs()) / Prescalerfactor);
       break;
     case HERTZ_COMPARE_FORMAT:
       CCR_RegisterValue = getTimerClkFreq() / (compare * Prescalerfactor);
@@ -864,7 +866,7 @@ uint32_t HardwareTimer::getCaptureCompare(uint32_t channel,  TimerCompareFormat_
 
   switch (format) {
     case MICROSEC_COMPARE_FORMAT:
-      return_value = (uint32_t)((CCR_RegisterValue * Prescalerfactor * 1000000.0) / getTimerClkFreq());
+      return_value = ticksToMicros(CCR_RegisterValue * Prescalerfactor);
       break;
     case HERTZ_COMPARE_FORMAT:
       return_value = (uint32_t)(getTimerClkFreq() / (CCR_RegisterValue  * Prescalerfactor));
@@ -907,11 +909,22 @@ uint32_t HardwareTimer::getCaptureCompare(uint32_t channel,  TimerCompareFormat_
   * @param  CompareCallback: timer compare callback
   * @retval None
   */
-void HardwareTimer::setPWM(uint32_t channel, uint32_t pin, uint32_t frequency, uint32_t dutycycle, callback_function_t PeriodCallback, callback_function_t CompareCallback)
+void HardwareTimer::setPWM(uint32_t channel, uint32_t pin, uint32_t frequency, uint32_t dutycycle, void (*PeriodCallback)(void), void (*CompareCallback)(void))
 {
   setPWM(channel, digitalPinToPinName(pin), frequency, dutycycle, PeriodCallback, CompareCallback);
 }
 
+/**
+  * @brief  Pin name of an Arduino pin number, for the setPWM() templates
+  *         (digitalPinToPinName() is not declared before HardwareTimer.h)
+  * @param  pin: Arduino pin number
+  * @retval pin name
+  */
+PinName HardwareTimer::pinName(uint32_t pin)
+{
+  return digitalPinToPinName(pin);
+}
+
 /**
   * @brief  All in one function to configure PWM
   * @param  channel: Arduino channel [1..4]
@@ -922,7 +935,7 @@ void HardwareTimer::setPWM(uint32_t channel, uint32_t pin, uint32_t frequency, u
   * @param  CompareCallback: timer compare callback
   * @retval None
   */
-void HardwareTimer::setPWM(uint32_t channel, PinName pin, uint32_t frequency, uint32_t dutycycle, callback_function_t PeriodCallback, callback_function_t CompareCallback)
+void HardwareTimer::setPWM(uint32_t channel, PinName pin, uint32_t frequency, uint32_t dutycycle, void (*PeriodCallback)(void), void (*CompareCallback)(void))
 {
   setMode(channel, TIMER_OUTPUT_COMPARE_PWM1, pin);
   setOverflow(frequency, HERTZ_FORMAT);
@@ -959,26 +972,98 @@ void HardwareTimer::setInterruptPriority(uint32_t preemptPriority, uint32_t subP
 }
 
 /**
-  * @brief  Attach interrupt callback on update (rollover) event
-  * @param  callback: interrupt callback
+  * @brief  Call a callback without argument, stored as the argument
+  * @param  arg: void (*)(void) callback
+  * @retval None
+  */
+void HardwareTimer::callPlain(void *arg)
+{
+  ((void (*)(void))arg)();
+}
+
+/**
+  * @brief  Store the callback of update event (channel 0) or of a Capture/Compare channel
+  * @note   The interrupt is only enabled when a callback is attached to a free slot,
+  *         otherwise it is just a change of callback.
+  * @param  channel: 0 for update event, Arduino channel [1..4] otherwise
+  * @param  callback: interrupt callback, called with arg
+  * @param  arg: callback argument
+  * @param  release: called with arg once the callback is replaced or detached, may be NULL
   * @retval None
   */
-void HardwareTimer::attachInterrupt(callback_function_t callback)
+void HardwareTimer::attachCallback(uint32_t channel, callback_arg_function_t callback, void *arg, void (*release)(void *arg))
 {
-  if (callbacks[0]) {
+  int interrupt = TIM_IT_UPDATE;
+  if (channel != 0) {
+    interrupt = getIT(channel);
+    if (interrupt == -1) {
+      Error_Handler();
+    }
+    if (channel > (TIMER_CHANNELS + 1)) {
+      Error_Handler();  // only channel 1..4 have an interrupt
+    }
+  }
+
+  bool attached = (callbacks[channel].function != NULL);
+  bool enabled = (__HAL_TIM_GET_IT_SOURCE(&(_timerObj.handle), interrupt) != RESET);
+  // The interrupt must not see a callback with a released argument
+  __HAL_TIM_DISABLE_IT(&(_timerObj.handle), interrupt);
+  clearCallback(channel);
+  callbacks[channel].arg = arg;
+  callbacks[channel].release = release;
+  callbacks[channel].function = callback;
+  if (attached) {
     // Callback previously configured : do not clear neither enable IT, it is just a change of callback
-    callbacks[0] = callback;
-  } else {
-    callbacks[0] = callback;
-    if (callback) {
-      // Clear flag before enabling IT
-      __HAL_TIM_CLEAR_FLAG(&(_timerObj.handle), TIM_FLAG_UPDATE);
-      // Enable update interrupt only if callback is valid
-      __HAL_TIM_ENABLE_IT(&(_timerObj.handle), TIM_IT_UPDATE);
+    if (enabled) {
+      __HAL_TIM_ENABLE_IT(&(_timerObj.handle), interrupt);
     }
+  } else if (callback) {
+    // Clear flag before enabling IT
+    __HAL_TIM_CLEAR_FLAG(&(_timerObj.handle), interrupt);
+    // Enable interrupt only if callback is valid
+    __HAL_TIM_ENABLE_IT(&(_timerObj.handle), interrupt);
   }
 }
 
+/**
+  * @brief  Remove a callback, releasing its argument
+  * @param  channel: 0 for update event, Arduino channel [1..4] otherwise
+  * @retval None
+  */
+void HardwareTimer::clearCallback(uint32_t channel)
+{
+  void (*release)(void *arg) = callbacks[channel].release;
+  void *arg = callbacks[channel].arg;
+
+  callbacks[channel].function = NULL;
+  callbacks[channel].arg = NULL;
+  callbacks[channel].release = NULL;
+  if (release) {
+    release(arg);
+  }
+}
+
+/**
+  * @brief  Attach interrupt callback on update (rollover) event
+  * @param  callback: interrupt callback
+  * @retval None
+  */
+void HardwareTimer::attachInterrupt(void (*callback)(void))
+{
+  attachCallback(0, callback ? callPlain : NULL, (void *)callback, NULL);
+}
+
+/**
+  * @brief  Attach interrupt callback on update (rollover) event
+  * @param  callback: interrupt callback
+  * @param  arg: argument given to callback
+  * @retval None
+  */
+void HardwareTimer::attachInterrupt(callback_arg_function_t callback, void *arg)
+{
+  attachCallback(0, callback, arg, NULL);
+}
+
 /**
   * @brief  Detach interrupt callback on update (rollover) event
   * @retval None
@@ -987,7 +1072,7 @@ void HardwareTimer::detachInterrupt()
 {
   // Disable update interrupt and clear callback
   __HAL_TIM_DISABLE_IT(&(_timerObj.handle), TIM_IT_UPDATE); // disables the interrupt call to save cpu cycles for useless context switching
-  callbacks[0] = NULL;
+  clearCallback(0);
 }
 
 /**
@@ -996,28 +1081,27 @@ void HardwareTimer::detachInterrupt()
   * @param  callback: interrupt callback
   * @retval None
   */
-void HardwareTimer::attachInterrupt(uint32_t channel, callback_function_t callback)
+void HardwareTimer::attachInterrupt(uint32_t channel, void (*callback)(void))
 {
-  int interrupt = getIT(channel);
-  if (interrupt == -1) {
-    Error_Handler();
+  if (channel == 0) {
+    Error_Handler();  // only channel 1..4 have an interrupt
   }
+  attachCallback(channel, callback ? callPlain : NULL, (void *)callback, NULL);
+}
 
-  if ((channel == 0) || (channel > (TIMER_CHANNELS + 1))) {
+/**
+  * @brief  Attach interrupt callback on Capture/Compare event
+  * @param  channel: Arduino channel [1..4]
+  * @param  callback: interrupt callback
+  * @param  arg: argument given to callback
+  * @retval None
+  */
+void HardwareTimer::attachInterrupt(uint32_t channel, callback_arg_function_t callback, void *arg)
+{
+  if (channel == 0) {
     Error_Handler();  // only channel 1..4 have an interrupt
   }
-  if (callbacks[channel]) {
-    // Callback previously configured : do not clear neither enable IT, it is just a change of callback
-    callbacks[channel] = callback;
-  } else {
-    callbacks[channel] = callback;
-    if (callback) {
-      // Clear flag before enabling IT
-      __HAL_TIM_CLEAR_FLAG(&(_timerObj.handle), interrupt);
-      // Enable interrupt corresponding to channel, only if callback is valid
-      __HAL_TIM_ENABLE_IT(&(_timerObj.handle), interrupt);
-    }
-  }
+  attachCallback(channel, callback, arg, NULL);
 }
 
 /**
@@ -1038,7 +1122,7 @@ void HardwareTimer::detachInterrupt(uint32_t channel)
 
   // Disable interrupt corresponding to channel and clear callback
   __HAL_TIM_DISABLE_IT(&(_timerObj.handle), interrupt);
-  callbacks[channel] = NULL;
+  clearCallback(channel);
 }
 
 /**
@@ -1047,7 +1131,7 @@ void HardwareTimer::detachInterrupt(uint32_t channel)
   */
 bool HardwareTimer::hasInterrupt()
 {
-  return callbacks[0] != NULL;
+  return callbacks[0].function != NULL;
 }
 
 /**
@@ -1060,7 +1144,7 @@ bool HardwareTimer::hasInterrupt(uint32_t channel)
   if ((channel == 0) || (channel > (TIMER_CHANNELS + 1))) {
     Error_Handler();  // only channel 1..4 have an interrupt
   }
-  return callbacks[channel] != NULL;
+  return callbacks[channel].function != NULL;
 }
 
 /**
@@ -1075,6 +1159,196 @@ void HardwareTimer::refresh()
   HAL_TIM_GenerateEvent(&(_timerObj.handle), TIM_EVENTSOURCE_UPDATE);
 }
 
+#define NO_INTERNAL_TRIGGER 0xFFFFFFFFU
+
+/**
+  * @brief  Internal trigger input of a slave timer wired to the TRGO of a master timer
+  * @param  slave: slave timer instance
+  * @param  master: master timer instance
+  * @retval LL_TIM_TS_ITRx, NO_INTERNAL_TRIGGER if they are not connected
+  */
+static uint32_t internalTrigger(TIM_TypeDef *slave, TIM_TypeDef *master)
+{
+  if (!IS_TIM_SLAVE_INSTANCE(slave) || !IS_TIM_MASTER_INSTANCE(master)) {
+    return NO_INTERNAL_TRIGGER;
+  }
+#if defined(TIM3)
+  if ((slave == TIM1) && (master == TIM3)) {
+    return LL_TIM_TS_ITR2;
+  }
+  if ((slave == TIM3) && (master == TIM1)) {
+    return LL_TIM_TS_ITR0;
+  }
+#endif
+  return NO_INTERNAL_TRIGGER;
+}
+
+/**
+  * @brief  Select the event sent on TRGO to the slave timers
+  * @param  trgo: event, see TimerMasterOutput_t
+  * @retval false if this timer has no master mode
+  */
+bool HardwareTimer::setMasterOutput(TimerMasterOutput_t trgo)
+{
+  static const uint32_t outputs[] = {
+    LL_TIM_TRGO_RESET,
+    LL_TIM_TRGO_ENABLE,
+    LL_TIM_TRGO_UPDATE,
+    LL_TIM_TRGO_CC1IF,
+    LL_TIM_TRGO_OC1REF,
+    LL_TIM_TRGO_OC2REF,
+    LL_TIM_TRGO_OC3REF,
+    LL_TIM_TRGO_OC4REF,
+  };
+  TIM_TypeDef *instance = _timerObj.handle.Instance;
+
+  if (!IS_TIM_MASTER_INSTANCE(instance) || ((uint32_t)trgo >= sizeof(outputs) / sizeof(outputs[0]))) {
+    return false;
+  }
+  LL_TIM_SetTriggerOutput(instance, outputs[trgo]);
+  return true;
+}
+
+/**
+  * @brief  Make this timer a slave of the TRGO output of master
+  * @note   TIM1 and TIM3 are wired to each other. TIMER_SLAVE_EXTERNAL_CLOCK
+  *         with a master sending TIMER_TRGO_UPDATE chains both counters.
+  * @param  mode: slave mode, see TimerSlaveMode_t
+  * @param  master: master timer, unused for TIMER_SLAVE_DISABLED
+  * @retval false if this timer has no slave mode or is not connected to master
+  */
+bool HardwareTimer::setSlaveMode(TimerSlaveMode_t mode, HardwareTimer *master)
+{
+  TIM_TypeDef *instance = _timerObj.handle.Instance;
+
+  if (!IS_TIM_SLAVE_INSTANCE(instance)) {
+    return false;
+  }
+  // The trigger input must only be changed while slave mode is disabled
+  LL_TIM_SetSlaveMode(instance, LL_TIM_SLAVEMODE_DISABLED);
+  if (mode == TIMER_SLAVE_DISABLED) {
+    return true;
+  }
+  if (master == nullptr) {
+    return false;
+  }
+  uint32_t itr = internalTrigger(instance, master->_timerObj.handle.Instance);
+  if (itr == NO_INTERNAL_TRIGGER) {
+    return false;
+  }
+  LL_TIM_SetTriggerInput(instance, itr);
+  switch (mode) {
+    case TIMER_SLAVE_RESET:
+      LL_TIM_SetSlaveMode(instance, LL_TIM_SLAVEMODE_RESET);
+      break;
+    case TIMER_SLAVE_GATED:
+      LL_TIM_SetSlaveMode(instance, LL_TIM_SLAVEMODE_GATED);
+      break;
+    case TIMER_SLAVE_TRIGGER:
+      LL_TIM_SetSlaveMode(instance, LL_TIM_SLAVEMODE_TRIGGER);
+      break;
+    case TIMER_SLAVE_EXTERNAL_CLOCK:
+      LL_TIM_SetClockSource(instance, LL_TIM_CLOCKSOURCE_EXT_MODE1);
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+/**
+  * @brief  Resume a group of timers so that their counters start together
+  * @note   timers[0] is resumed last. Every other timer wired to it (see
+  *         setSlaveMode()) is held in trigger mode and started in hardware
+  *         by its counter enable, a fixed resynchronization delay of about
+  *         one timer clock later; setCount() can compensate for it. The
+  *         others are enabled by software right after it, a few CPU cycles
+  *         apart. The counters start from their current values, so phase
+  *         offsets can be set with setCount() beforehand. TRGO and slave
+  *         settings are restored once the group is running. A slave the
+  *         trigger does not start within a bounded wait is started by
+  *         software, and the function returns false.
+  * @param  timers: timers to start, paused and configured
+  * @param  count: number of timers
+  * @retval true if all timers were started by the hardware trigger
+  */
+bool HardwareTimer::resumeSynchronized(HardwareTimer *const timers[], uint32_t count)
+{
+  const uint32_t SYNC_START_LOOPS = 1000;
+  uint32_t slaveConfig[TIMER_NUM];
+  uint32_t triggered = 0;
+
+  if ((timers == nullptr) || (count == 0) || (count > TIMER_NUM)) {
+    return false;
+  }
+  TIM_TypeDef *master = timers[0]->_timerObj.handle.Instance;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  for (uint32_t i = 1; i < count; i++) {
+    TIM_TypeDef *instance = timers[i]->_timerObj.handle.Instance;
+    uint32_t itr = internalTrigger(instance, master);
+    if (itr != NO_INTERNAL_TRIGGER) {
+      slaveConfig[i] = instance->SMCR;
+      LL_TIM_SetSlaveMode(instance, LL_TIM_SLAVEMODE_DISABLED);
+      LL_TIM_SetTriggerInput(instance, itr);
+      LL_TIM_SetSlaveMode(instance, LL_TIM_SLAVEMODE_TRIGGER);
+      triggered |= (1UL << i);
+    }
+  }
+
+  // Arm channels and interrupts. HAL leaves the counter of a timer in
+  // trigger mode stopped; the others are stopped again right away.
+  for (uint32_t i = 0; i < count; i++) {
+    TIM_TypeDef *instance = timers[i]->_timerObj.handle.Instance;
+    if (triggered & (1UL << i)) {
+      timers[i]->resume();
+    } else {
+      uint32_t counter = LL_TIM_GetCounter(instance);
+      timers[i]->resume();
+      LL_TIM_DisableCounter(instance);
+      LL_TIM_SetCounter(instance, counter);
+    }
+  }
+
+  uint32_t masterOutput = master->CR2 & TIM_CR2_MMS;
+  if (triggered != 0) {
+    LL_TIM_SetTriggerOutput(master, LL_TIM_TRGO_ENABLE);
+  }
+  LL_TIM_EnableCounter(master);
+  for (uint32_t i = 1; i < count; i++) {
+    if (!(triggered & (1UL << i))) {
+      LL_TIM_EnableCounter(timers[i]->_timerObj.handle.Instance);
+    }
+  }
+
+  // The trigger must reach the slaves before TRGO goes back. It takes a few
+  // timer clocks: a slave still stopped after SYNC_START_LOOPS polls is not
+  // wired as expected, start it by software rather than hang with IRQs off.
+  for (uint32_t i = 1; i < count; i++) {
+    if (triggered & (1UL << i)) {
+      TIM_TypeDef *instance = timers[i]->_timerObj.handle.Instance;
+      uint32_t loops = SYNC_START_LOOPS;
+      while (!LL_TIM_IsEnabledCounter(instance)) {
+        if (--loops == 0) {
+          triggered &= ~(1UL << i);
+          break;
+        }
+      }
+      instance->SMCR = slaveConfig[i];
+      if (!(triggered & (1UL << i))) {
+        LL_TIM_EnableCounter(instance);
+      }
+    }
+  }
+  if (triggered != 0) {
+    LL_TIM_SetTriggerOutput(master, masterOutput);
+  }
+
+  __set_PRIMASK(primask);
+  return triggered == (((1UL << count) - 1) & ~1UL);
+}
+
 /**
   * @brief  Return the timer object handle object for more advanced setup
   * @note   Using this function and editing the Timer handle is at own risk! No support will
@@ -1101,8 +1375,8 @@ void HardwareTimer::updateCallback(TIM_HandleTypeDef *htim)
   timerObj_t *obj = get_timer_obj(htim);
   HardwareTimer *HT = (HardwareTimer *)(obj->__this);
 
-  if (HT->callbacks[0]) {
-    HT->callbacks[0]();
+  if (HT->callbacks[0].function) {
+    HT->callbacks[0].function(HT->callbacks[0].arg);
   }
 }
 
@@ -1142,8 +1416,8 @@ void HardwareTimer::captureCompareCallback(TIM_HandleTypeDef *htim)
   timerObj_t *obj = get_timer_obj(htim);
   HardwareTimer *HT = (HardwareTimer *)(obj->__this);
 
-  if (HT->callbacks[channel]) {
-    HT->callbacks[channel]();
+  if (HT->callbacks[channel].function) {
+    HT->callbacks[channel].function(HT->callbacks[channel].arg);
   }
 }
 
@@ -1213,6 +1487,9 @@ HardwareTimer::~HardwareTimer()
   disableTimerClock(&(_timerObj.handle));
   HardwareTimer_Handle[index] = NULL;
   _timerObj.__this = NULL;
+  for (int i = 0; i < TIMER_CHANNELS + 1 ; i++) {
+    clearCallback(i);
+  }
 }
 
 /**
@@ -1337,12 +1614,82 @@ timer_index_t get_timer_index(TIM_TypeDef *instance)
   return index;
 }
 
+volatile uint32_t HardwareTimer::_clockEpoch = 1;
+
+/**
+  * @brief  Invalidate the timer clock cached by every HardwareTimer
+  * @note   Call after changing the system/APB clocks at runtime, e.g. after
+  *         SystemClock_Config() on a sleep exit.
+  * @retval None
+  */
+void HardwareTimer::clockChanged()
+{
+  _clockEpoch++;
+}
+
+/**
+  * @brief  Recompute the cached timer clock if the clocks changed
+  * @retval None
+  */
+void HardwareTimer::refreshTimerClk()
+{
+  if (_timerClkEpoch != _clockEpoch) {
+    _timerClkFreq = computeTimerClkFreq();
+    _timerClkPerUs = _timerClkFreq / 1000000;
+    // 2^32 * 1e6 / f, rounded up; ticksToMicros() trims the result back down
+    // by at most one. Only fits 32 bits when f > 1 MHz, divide otherwise.
+    _usPerTickQ32 = (_timerClkFreq > 1000000) ?
+                    (uint32_t)(((1000000ULL << 32) + _timerClkFreq - 1) / _timerClkFreq) : 0;
+    _timerClkEpoch = _clockEpoch;
+  }
+}
+
+/**
+  * @brief  Timer clock in MHz (ticks per microsecond), cached
+  * @retval ticks per microsecond
+  */
+uint32_t HardwareTimer::getTimerClkPerUs()
+{
+  refreshTimerClk();
+  return _timerClkPerUs;
+}
+
+/**
+  * @brief  Convert timer clock ticks to microseconds without dividing
+  * @param  ticks: number of timer input clock cycles
+  * @retval microseconds
+  */
+uint32_t HardwareTimer::ticksToMicros(uint32_t ticks)
+{
+  refreshTimerClk();
+  if (_usPerTickQ32 == 0) {
+    return (uint32_t)(((uint64_t)ticks * 1000000) / _timerClkFreq);
+  }
+  uint32_t us = (uint32_t)(((uint64_t)ticks * _usPerTickQ32) >> 32);
+  // Rounded-up reciprocal may overshoot by one: keep the truncated result.
+  if ((uint64_t)us * _timerClkFreq > (uint64_t)ticks * 1000000) {
+    us--;
+  }
+  return us;
+}
+
 /**
   * @brief  This function return the timer clock frequency.
+  * @note   Cached until clockChanged()
   * @param  None
   * @retval frequency in Hz
   */
 uint32_t HardwareTimer::getTimerClkFreq()
+{
+  refreshTimerClk();
+  return _timerClkFreq;
+}
+
+/**
+  * @brief  Compute the timer input clock frequency from the RCC configuration
+  * @retval frequency in Hz
+  */
+uint32_t HardwareTimer::computeTimerClkFreq()
 {
 #if defined(AIRMP1xx)
   uint8_t timerClkSrc = getTimerClkSrc(_timerObj.handle.Instance);
@@ -12,8 +12,10 @@
  */
 #include "analog.h"
 #include "lock_resource.h"
+#include "dma.h"
 #if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
 #include "py32yyxx_ll_adc.h"
+#include "py32yyxx_ll_gpio.h"
 #endif
 
 #ifdef __cplusplus
@@ -25,10 +27,33 @@ extern "C" {
     (defined(HAL_DAC_MODULE_ENABLED) && !defined(HAL_DAC_MODULE_ONLY))
 static PinName g_current_pin = NC;
 #endif
+#if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
+/* Persistent ADC session, see adc_session_begin() */
+static ADC_HandleTypeDef g_adc_session = {};
+static uint32_t g_adc_session_resolution = 0;
+/* Continuous conversions checked by the analog watchdog, see adc_watchdog_start() */
+static ADC_HandleTypeDef g_adc_watchdog = {};
+static PinName g_adc_watchdog_pin = NC;
+static void (*g_adc_watchdog_callback)(uint16_t value) = NULL;
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+/* Background conversions streamed by DMA, see adc_stream_start() */
+static ADC_HandleTypeDef g_adc_stream = {};
+static DMA_HandleTypeDef g_adc_stream_dma = {};
+static void (*g_adc_stream_callback)(uint8_t half) = NULL;
+static uint8_t g_adc_stream_running = 0;
+static uint32_t g_adc_stream_length = 0;
+#endif
+#endif
 
 /* Private_Defines */
 #if defined(HAL_ADC_MODULE_ENABLED) && !defined(HAL_ADC_MODULE_ONLY)
 
+/* Polls of ADSTART after ADSTP where HAL_GetTick() may not advance (from an
+ * interrupt): far above the longest conversion at the slowest ADC clock */
+#ifndef ADC_STOP_LOOPS
+#define ADC_STOP_LOOPS          100000U
+#endif
+
 #ifndef ADC_SAMPLINGTIME
 #if defined(ADC_SAMPLETIME_8CYCLES_5)
 #define ADC_SAMPLINGTIME        ADC_SAMPLETIME_8CYCLES_5;
@@ -100,6 +125,11 @@ static PinName g_current_pin = NC;
 #define ADC_REGULAR_RANK_1  1
 #endif
 
+/* Temperature sensor stabilization time, same as HAL_ADC_ConfigChannel() */
+#ifndef ADC_TEMPSENSOR_DELAY_US
+#define ADC_TEMPSENSOR_DELAY_US 10U
+#endif
+
 /* Exported Functions */
 /**
   * @brief  Return ADC HAL channel linked to a PinName
@@ -775,16 +805,15 @@ void HAL_ADC_MspDeInit(ADC_HandleTypeDef *hadc)
 }
 
 /**
-  * @brief  This function will set the ADC to the required value
+  * @brief  Initialize and calibrate the ADC for a pin
+  * @param  AdcHandle : ADC handle to initialize
   * @param  pin : the pin to use
   * @param  resolution : resolution for converted data: 6/8/10/12/14/16
-  * @retval the value of the adc
+  * @retval 1 if the ADC is ready to start a conversion, 0 otherwise
   */
-uint16_t adc_read_value(PinName pin, uint32_t resolution)
+static uint8_t adc_configure(ADC_HandleTypeDef *AdcHandle, PinName pin, uint32_t resolution)
 {
-  ADC_HandleTypeDef AdcHandle = {};
   ADC_ChannelConfTypeDef  AdcChannelConf = {};
-  __IO uint16_t uhADCxConvertedValue = 0;
   uint32_t samplingTime = ADC_SAMPLINGTIME;
   uint32_t channel = 0;
   uint32_t bank = 0;
@@ -792,67 +821,67 @@ uint16_t adc_read_value(PinName pin, uint32_t resolution)
   if ((pin & PADC_BASE) && (pin < ANA_START)) {
 #if defined(AIRH7xx) || defined(AIRMP1xx)
 #ifdef ADC3
-    AdcHandle.Instance = ADC3;
+    AdcHandle->Instance = ADC3;
 #else
-    AdcHandle.Instance = ADC2;
+    AdcHandle->Instance = ADC2;
 #endif
 #else
-    AdcHandle.Instance = ADC1;
+    AdcHandle->Instance = ADC1;
 #if defined(ADC5) && defined(ADC_CHANNEL_TEMPSENSOR_ADC5)
     if (pin == PADC_TEMP_ADC5) {
-      AdcHandle.Instance = ADC5;
+      AdcHandle->Instance = ADC5;
     }
 #endif
 #endif
     channel = get_adc_internal_channel(pin);
     samplingTime = ADC_SAMPLINGTIME_INTERNAL;
   } else {
-    AdcHandle.Instance = (ADC_TypeDef *)pinmap_peripheral(pin, PinMap_ADC);
+    AdcHandle->Instance = (ADC_TypeDef *)pinmap_peripheral(pin, PinMap_ADC);
     channel = get_adc_channel(pin, &bank);
 #if defined(ADC_VER_V5_V90)
-    if (AdcHandle.Instance == ADC3) {
+    if (AdcHandle->Instance == ADC3) {
       samplingTime = ADC3_SAMPLINGTIME;
     }
 #endif
 #if defined(ADC4_SAMPLINGTIME)
-    if (AdcHandle.Instance == ADC4) {
+    if (AdcHandle->Instance == ADC4) {
       samplingTime = ADC4_SAMPLINGTIME;
     }
 #endif
   }
 
-  if (AdcHandle.Instance == NP) {
+  if (AdcHandle->Instance == NP) {
     return 0;
   }
 
 #ifdef ADC_CLOCK_DIV
-  AdcHandle.Init.ClockPrescaler        = ADC_CLOCK_DIV;                 /* (A)synchronous clock mode, input ADC clock divided */
+  AdcHandle->Init.ClockPrescaler        = ADC_CLOCK_DIV;                 /* (A)synchronous clock mode, input ADC clock divided */
 #endif
 #ifdef ADC_RESOLUTION_12B
   switch (resolution) {
 #ifdef ADC_RESOLUTION_6B
     case 6:
-      AdcHandle.Init.Resolution          = ADC_RESOLUTION_6B;             /* resolution for converted data */
+      AdcHandle->Init.Resolution          = ADC_RESOLUTION_6B;             /* resolution for converted data */
       break;
 #endif
     case 8:
-      AdcHandle.Init.Resolution          = ADC_RESOLUTION_8B;             /* resolution for converted data */
+      AdcHandle->Init.Resolution          = ADC_RESOLUTION_8B;             /* resolution for converted data */
       break;
     case 10:
-      AdcHandle.Init.Resolution          = ADC_RESOLUTION_10B;            /* resolution for converted data */
+      AdcHandle->Init.Resolution          = ADC_RESOLUTION_10B;            /* resolution for converted data */
       break;
     case 12:
     default:
-      AdcHandle.Init.Resolution          = ADC_RESOLUTION_12B;            /* resolution for converted data */
+      AdcHandle->Init.Resolution          = ADC_RESOLUTION_12B;            /* resolution for converted data */
       break;
 #ifdef ADC_RESOLUTION_14B
     case 14:
-      AdcHandle.Init.Resolution          = ADC_RESOLUTION_14B;            /* resolution for converted data */
+      AdcHandle->Init.Resolution          = ADC_RESOLUTION_14B;            /* resolution for converted data */
       break;
 #endif
 #ifdef ADC_RESOLUTION_16B
     case 16:
-      AdcHandle.Init.Resolution          = ADC_RESOLUTION_16B;            /* resolution for converted data */
+      AdcHandle->Init.Resolution          = ADC_RESOLUTION_16B;            /* resolution for converted data */
       break;
 #endif
   }
@@ -860,98 +889,98 @@ uint16_t adc_read_value(PinName pin, uint32_t resolution)
   UNUSED(resolution);
 #endif
 #ifdef ADC_DATAALIGN_RIGHT
-  AdcHandle.Init.DataAlign             = ADC_DATAALIGN_RIGHT;           /* Right-alignment for converted data */
+  AdcHandle->Init.DataAlign             = ADC_DATAALIGN_RIGHT;           /* Right-alignment for converted data */
 #endif
 #ifdef ADC_SCAN_SEQ_FIXED
-  AdcHandle.Init.ScanConvMode          = ADC_SCAN_SEQ_FIXED;            /* Sequencer disabled (ADC conversion on only 1 channel: channel set on rank 1) */
+  AdcHandle->Init.ScanConvMode          = ADC_SCAN_SEQ_FIXED;            /* Sequencer disabled (ADC conversion on only 1 channel: channel set on rank 1) */
 #else
-  AdcHandle.Init.ScanConvMode          = DISABLE;                       /* Sequencer disabled (ADC conversion on only 1 channel: channel set on rank 1) */
+  AdcHandle->Init.ScanConvMode          = DISABLE;                       /* Sequencer disabled (ADC conversion on only 1 channel: channel set on rank 1) */
 #endif
 #ifdef ADC_EOC_SINGLE_CONV
-  AdcHandle.Init.EOCSelection          = ADC_EOC_SINGLE_CONV;           /* EOC flag picked-up to indicate conversion end */
+  AdcHandle->Init.EOCSelection          = ADC_EOC_SINGLE_CONV;           /* EOC flag picked-up to indicate conversion end */
 #endif
 #if !defined(AIR32F1xx) && !defined(AIRF2xx) && !defined(AIRF4xx) && \
     !defined(AIRF7xx) && !defined(ADC1_V2_5)
-  AdcHandle.Init.LowPowerAutoWait      = DISABLE;                       /* Auto-delayed conversion feature disabled */
+  AdcHandle->Init.LowPowerAutoWait      = DISABLE;                       /* Auto-delayed conversion feature disabled */
 #endif
 #if !defined(AIR32F1xx) && !defined(AIRF2xx) && !defined(AIRF3xx) && \
     !defined(AIRF4xx) && !defined(AIRF7xx) && !defined(AIRG4xx) && \
     !defined(AIRH7xx) && !defined(AIRL4xx) && !defined(AIRL5xx) && \
     !defined(AIRMP1xx) && !defined(AIRWBxx) ||  defined(ADC_SUPPORT_2_5_MSPS)
-  AdcHandle.Init.LowPowerAutoPowerOff  = DISABLE;                       /* ADC automatically powers-off after a conversion and automatically wakes-up when a new conversion is triggered */
+  AdcHandle->Init.LowPowerAutoPowerOff  = DISABLE;                       /* ADC automatically powers-off after a conversion and automatically wakes-up when a new conversion is triggered */
 #endif
 #ifdef ADC_CHANNELS_BANK_B
-  AdcHandle.Init.ChannelsBank          = bank;
+  AdcHandle->Init.ChannelsBank          = bank;
 #elif defined(ADC_CHANNELS_BANK_A)
-  AdcHandle.Init.ChannelsBank          = ADC_CHANNELS_BANK_A;
+  AdcHandle->Init.ChannelsBank          = ADC_CHANNELS_BANK_A;
 #endif
-  AdcHandle.Init.ContinuousConvMode    = DISABLE;                       /* Continuous mode disabled to have only 1 conversion at each conversion trig */
+  AdcHandle->Init.ContinuousConvMode    = DISABLE;                       /* Continuous mode disabled to have only 1 conversion at each conversion trig */
 #if !defined(PY32F0xx) && !defined(AIRL0xx)
-  AdcHandle.Init.NbrOfConversion       = 1;                             /* Specifies the number of ranks that will be converted within the regular group sequencer. */
+  AdcHandle->Init.NbrOfConversion       = 1;                             /* Specifies the number of ranks that will be converted within the regular group sequencer. */
 #endif
-  AdcHandle.Init.DiscontinuousConvMode = DISABLE;                       /* Parameter discarded because sequencer is disabled */
+  AdcHandle->Init.DiscontinuousConvMode = DISABLE;                       /* Parameter discarded because sequencer is disabled */
 #if !defined(AIRC0xx) && !defined(PY32F0xx) && !defined(AIRG0xx) && \
     !defined(AIRL0xx) && !defined(AIRWLxx) && !defined(ADC_SUPPORT_2_5_MSPS)
-  AdcHandle.Init.NbrOfDiscConversion   = 0;                             /* Parameter discarded because sequencer is disabled */
+  AdcHandle->Init.NbrOfDiscConversion   = 0;                             /* Parameter discarded because sequencer is disabled */
 #endif
-  AdcHandle.Init.ExternalTrigConv      = ADC_SOFTWARE_START;            /* Software start to trig the 1st conversion manually, without external event */
+  AdcHandle->Init.ExternalTrigConv      = ADC_SOFTWARE_START;            /* Software start to trig the 1st conversion manually, without external event */
 #if !defined(AIR32F1xx) && !defined(ADC1_V2_5)
-  AdcHandle.Init.ExternalTrigConvEdge  = ADC_EXTERNALTRIGCONVEDGE_NONE; /* Parameter discarded because software trigger chosen */
+  AdcHandle->Init.ExternalTrigConvEdge  = ADC_EXTERNALTRIGCONVEDGE_NONE; /* Parameter discarded because software trigger chosen */
 #endif
 #if !defined(AIR32F1xx) && !defined(AIRH7xx) && !defined(AIRMP1xx) && \
     !defined(PY32F002Ax5) && \
     !defined(ADC1_V2_5)
-  AdcHandle.Init.DMAContinuousRequests = DISABLE;                       /* DMA one-shot mode selected (not applied to this example) */
+  AdcHandle->Init.DMAContinuousRequests = DISABLE;                       /* DMA one-shot mode selected (not applied to this example) */
 #endif
 #ifdef ADC_CONVERSIONDATA_DR
-  AdcHandle.Init.ConversionDataManagement = ADC_CONVERSIONDATA_DR;      /* Regular Conversion data stored in DR register only */
+  AdcHandle->Init.ConversionDataManagement = ADC_CONVERSIONDATA_DR;      /* Regular Conversion data stored in DR register only */
 #endif
 #ifdef ADC_OVR_DATA_OVERWRITTEN
-  AdcHandle.Init.Overrun               = ADC_OVR_DATA_OVERWRITTEN;      /* DR register is overwritten with the last conversion result in case of overrun */
+  AdcHandle->Init.Overrun               = ADC_OVR_DATA_OVERWRITTEN;      /* DR register is overwritten with the last conversion result in case of overrun */
 #endif
 #ifdef ADC_LEFTBITSHIFT_NONE
-  AdcHandle.Init.LeftBitShift          = ADC_LEFTBITSHIFT_NONE;         /* No bit shift left applied on the final ADC conversion data */
+  AdcHandle->Init.LeftBitShift          = ADC_LEFTBITSHIFT_NONE;         /* No bit shift left applied on the final ADC conversion data */
 #endif
 
 #if defined(PY32F0xx)
-  AdcHandle.Init.SamplingTimeCommon    = samplingTime;
+  AdcHandle->Init.SamplingTimeCommon    = samplingTime;
 #endif
 #if defined(AIRC0xx) || defined(AIRG0xx) || defined(AIRU5xx) || \
     defined(AIRWLxx) || defined(ADC_SUPPORT_2_5_MSPS)
-  AdcHandle.Init.SamplingTimeCommon1   = samplingTime;              /* Set sampling time common to a group of channels. */
-  AdcHandle.Init.SamplingTimeCommon2   = samplingTime;              /* Set sampling time common to a group of channels, second common setting possible.*/
+  AdcHandle->Init.SamplingTimeCommon1   = samplingTime;              /* Set sampling time common to a group of channels. */
+  AdcHandle->Init.SamplingTimeCommon2   = samplingTime;              /* Set sampling time common to a group of channels, second common setting possible.*/
 #endif
 #if defined(AIRL0xx)
-  AdcHandle.Init.LowPowerFrequencyMode = DISABLE;                       /* To be enabled only if ADC clock < 2.8 MHz */
-  AdcHandle.Init.SamplingTime          = samplingTime;
+  AdcHandle->Init.LowPowerFrequencyMode = DISABLE;                       /* To be enabled only if ADC clock < 2.8 MHz */
+  AdcHandle->Init.SamplingTime          = samplingTime;
 #endif
 #if !defined(PY32F0xx) && !defined(AIR32F1xx) && !defined(AIRF2xx) && \
     !defined(AIRF3xx) && !defined(AIRF4xx) && !defined(AIRF7xx) && \
     !defined(AIRL1xx) && !defined(ADC_SUPPORT_2_5_MSPS)
-  AdcHandle.Init.OversamplingMode      = DISABLE;
-  /* AdcHandle.Init.Oversample ignore for AIRL0xx as oversampling disabled */
-  /* AdcHandle.Init.Oversampling ignored for other as oversampling disabled */
+  AdcHandle->Init.OversamplingMode      = DISABLE;
+  /* AdcHandle->Init.Oversample ignore for AIRL0xx as oversampling disabled */
+  /* AdcHandle->Init.Oversampling ignored for other as oversampling disabled */
 #endif
 #if defined(ADC_CFGR_DFSDMCFG) && defined(DFSDM1_Channel0)
-  AdcHandle.Init.DFSDMConfig           = ADC_DFSDM_MODE_DISABLE;        /* ADC conversions are not transferred by DFSDM. */
+  AdcHandle->Init.DFSDMConfig           = ADC_DFSDM_MODE_DISABLE;        /* ADC conversions are not transferred by DFSDM. */
 #endif
 #ifdef ADC_TRIGGER_FREQ_HIGH
-  AdcHandle.Init.TriggerFrequencyMode  = ADC_TRIGGER_FREQ_HIGH;
+  AdcHandle->Init.TriggerFrequencyMode  = ADC_TRIGGER_FREQ_HIGH;
 #endif
 #ifdef ADC_VREF_PPROT_NONE
-  AdcHandle.Init.VrefProtection = ADC_VREF_PPROT_NONE;
+  AdcHandle->Init.VrefProtection = ADC_VREF_PPROT_NONE;
 #endif
 
-  AdcHandle.State = HAL_ADC_STATE_RESET;
+  AdcHandle->State = HAL_ADC_STATE_RESET;
 #if !defined(PY32F002Ax5)
-  AdcHandle.DMA_Handle = NULL;
+  AdcHandle->DMA_Handle = NULL;
 #endif
-  AdcHandle.Lock = HAL_UNLOCKED;
+  AdcHandle->Lock = HAL_UNLOCKED;
   /* Some other ADC_HandleTypeDef fields exists but not required */
 
   g_current_pin = pin; /* Needed for HAL_ADC_MspInit*/
 
-  if (HAL_ADC_Init(&AdcHandle) != HAL_OK) {
+  if (HAL_ADC_Init(AdcHandle) != HAL_OK) {
     return 0;
   }
 
@@ -959,7 +988,7 @@ uint16_t adc_read_value(PinName pin, uint32_t resolution)
 
 #if defined(AIRG4xx) || defined(AIRL4xx) || defined(AIRL5xx) || \
     defined(AIRWBxx)
-  if (!IS_ADC_CHANNEL(&AdcHandle, AdcChannelConf.Channel)) {
+  if (!IS_ADC_CHANNEL(AdcHandle, AdcChannelConf.Channel)) {
 #else
   if (!IS_ADC_CHANNEL(AdcChannelConf.Channel)) {
 #endif
@@ -993,7 +1022,7 @@ uint16_t adc_read_value(PinName pin, uint32_t resolution)
 #endif
 
   /*##-2- Configure ADC regular channel ######################################*/
-  if (HAL_ADC_ConfigChannel(&AdcHandle, &AdcChannelConf) != HAL_OK) {
+  if (HAL_ADC_ConfigChannel(AdcHandle, &AdcChannelConf) != HAL_OK) {
     /* Channel Configuration Error */
     return 0;
   }
@@ -1001,11 +1030,11 @@ uint16_t adc_read_value(PinName pin, uint32_t resolution)
 #if defined(ADC_CR_ADCAL) || defined(ADC_CR2_RSTCAL)
   /*##-2.1- Calibrate ADC then Start the conversion process ####################*/
 #if defined(ADC_CALIB_OFFSET)
-  if (HAL_ADCEx_Calibration_Start(&AdcHandle, ADC_CALIB_OFFSET, ADC_SINGLE_ENDED) != HAL_OK)
+  if (HAL_ADCEx_Calibration_Start(AdcHandle, ADC_CALIB_OFFSET, ADC_SINGLE_ENDED) != HAL_OK)
 #elif defined(ADC_SINGLE_ENDED) && !defined(ADC1_V2_5)
-  if (HAL_ADCEx_Calibration_Start(&AdcHandle, ADC_SINGLE_ENDED) !=  HAL_OK)
+  if (HAL_ADCEx_Calibration_Start(AdcHandle, ADC_SINGLE_ENDED) !=  HAL_OK)
 #else
-  if (HAL_ADCEx_Calibration_Start(&AdcHandle) !=  HAL_OK)
+  if (HAL_ADCEx_Calibration_Start(AdcHandle) !=  HAL_OK)
 #endif
   {
     /* ADC Calibration Error */
@@ -1013,6 +1042,674 @@ uint16_t adc_read_value(PinName pin, uint32_t resolution)
   }
 #endif
 
+  return 1;
+}
+
+/**
+  * @brief  Start a persistent ADC session
+  * @note   The ADC is initialized and calibrated once, then left enabled:
+  *         each adc_read_value() only selects the channel in CHSELR and
+  *         runs a single conversion, instead of a full init/calibration/
+  *         deinit sequence. Call adc_session_end() to power the ADC down.
+  * @param  resolution : resolution for converted data: 6/8/10/12/14/16
+  * @retval 1 if the session is running, 0 otherwise
+  */
+uint8_t adc_session_begin(uint32_t resolution)
+{
+  if (g_adc_session_resolution == resolution) {
+    return 1;
+  }
+  if (g_adc_watchdog_pin != NC) {
+    return 0;
+  }
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+  if (g_adc_stream_running) {
+    return 0;
+  }
+#endif
+  if (g_adc_session_resolution != 0) {
+    adc_session_end();
+  }
+
+  /* Configure and calibrate on VrefInt, always available on ADC1 */
+  g_adc_session = {};
+  if (!adc_configure(&g_adc_session, PADC_VREF, resolution)) {
+    return 0;
+  }
+
+  /* A first conversion enables the ADC, it stays enabled afterwards */
+  if ((HAL_ADC_Start(&g_adc_session) != HAL_OK) ||
+      (HAL_ADC_PollForConversion(&g_adc_session, 10) != HAL_OK)) {
+    HAL_ADC_DeInit(&g_adc_session);
+    return 0;
+  }
+  (void)HAL_ADC_GetValue(&g_adc_session);
+
+  g_adc_session_resolution = resolution;
+  return 1;
+}
+
+/**
+  * @brief  Stop the persistent ADC session and power the ADC down
+  * @param  None
+  * @retval None
+  */
+void adc_session_end(void)
+{
+  if (g_adc_session_resolution != 0) {
+    g_adc_session_resolution = 0;
+    HAL_ADC_Stop(&g_adc_session);
+    HAL_ADC_DeInit(&g_adc_session);
+    if (__LL_ADC_COMMON_INSTANCE(g_adc_session.Instance) != 0U) {
+      LL_ADC_SetCommonPathInternalCh(__LL_ADC_COMMON_INSTANCE(g_adc_session.Instance), LL_ADC_PATH_INTERNAL_NONE);
+    }
+  }
+}
+
+/**
+  * @brief  Check if a persistent ADC session is running
+  * @param  None
+  * @retval 1 if running, 0 otherwise
+  */
+uint8_t adc_session_active(void)
+{
+  return (g_adc_session_resolution != 0);
+}
+
+/**
+  * @brief  Prepare a pin for a conversion in the persistent ADC session
+  * @param  pin : the pin to use
+  * @param  samplingTime : updated to the sampling time the pin needs
+  * @retval the ADC channel of the pin, 0xFFFFFFFF if not on the session ADC
+  */
+static uint32_t adc_session_prepare(PinName pin, uint32_t *samplingTime)
+{
+  uint32_t channel = 0;
+  uint32_t bank = 0;
+
+  if ((pin & PADC_BASE) && (pin < ANA_START)) {
+    channel = get_adc_internal_channel(pin);
+    *samplingTime = ADC_SAMPLINGTIME_INTERNAL;
+    if ((ADC->CCR & ADC_CHANNEL_INTERNAL_PATH(channel)) == 0U) {
+      ADC->CCR |= ADC_CHANNEL_INTERNAL_PATH(channel);
+      if (channel == ADC_CHANNEL_TEMPSENSOR) {
+        /* Temperature sensor stabilization time */
+        __IO uint32_t wait_loop_index = (ADC_TEMPSENSOR_DELAY_US * (SystemCoreClock / 1000000U));
+        while (wait_loop_index != 0U) {
+          wait_loop_index--;
+        }
+      }
+    }
+  } else {
+    if ((ADC_TypeDef *)pinmap_peripheral(pin, PinMap_ADC) != g_adc_session.Instance) {
+      return 0xFFFFFFFFU;
+    }
+    channel = get_adc_channel(pin, &bank);
+    /* The pin may have been reconfigured by pinMode() in between */
+    GPIO_TypeDef *port = get_GPIO_Port(PY32_PORT(pin));
+    if (LL_GPIO_GetPinMode(port, PY32_LL_GPIO_PIN(pin)) != LL_GPIO_MODE_ANALOG) {
+      pinmap_pinout(pin, PinMap_ADC);
+    }
+  }
+  UNUSED(bank);
+  return channel;
+}
+
+/**
+  * @brief  Convert a set of channels in the persistent ADC session
+  * @note   The sequencer converts the channels in ascending channel order.
+  *         Auto-delayed conversion (WAIT) holds each conversion until its
+  *         data is read, so no sample can be overwritten. On a conversion
+  *         timeout the sequence is aborted; if the ADC does not stop either,
+  *         the session is ended.
+  * @param  chselr : CHSELR channel mask
+  * @param  samplingTime : sampling time, common to all channels
+  * @param  raw : one value per channel of chselr, in channel order
+  * @param  count : number of channels in chselr
+  * @retval 1 if all channels are converted, 0 otherwise
+  */
+static uint8_t adc_session_scan(uint32_t chselr, uint32_t samplingTime, uint16_t *raw, uint32_t count)
+{
+  ADC_TypeDef *adc = g_adc_session.Instance;
+  uint8_t status = 1;
+  uint8_t stalled = 0;
+
+  if ((adc->SMPR & ADC_SMPR_SMP) != ADC_SMPR_SET(samplingTime)) {
+    MODIFY_REG(adc->SMPR, ADC_SMPR_SMP, ADC_SMPR_SET(samplingTime));
+  }
+  adc->CHSELR = chselr;
+  if (count > 1) {
+    SET_BIT(adc->CFGR1, ADC_CFGR1_WAIT);
+  }
+
+  WRITE_REG(adc->ISR, ADC_ISR_EOC | ADC_ISR_EOSEQ | ADC_ISR_OVR);
+  SET_BIT(adc->CR, ADC_CR_ADSTART);
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t tickstart = HAL_GetTick();
+    while ((adc->ISR & ADC_ISR_EOC) == 0U) {
+      if ((HAL_GetTick() - tickstart) > 10U) {
+        status = 0;
+        break;
+      }
+    }
+    if (status == 0) {
+      /* Abort the sequence, the next ADSTART restarts it from the start */
+      SET_BIT(adc->CR, ADC_CR_ADSTP);
+      tickstart = HAL_GetTick();
+      while ((adc->CR & ADC_CR_ADSTART) != 0U) {
+        if ((HAL_GetTick() - tickstart) > 2U) {
+          stalled = 1;
+          break;
+        }
+      }
+      break;
+    }
+    raw[i] = (uint16_t)adc->DR;
+  }
+
+  if (count > 1) {
+    CLEAR_BIT(adc->CFGR1, ADC_CFGR1_WAIT);
+  }
+  if (stalled) {
+    /* The ADC does not stop: power it down, the next read starts afresh */
+    adc_session_end();
+  }
+  return status;
+}
+
+/**
+  * @brief  Convert one channel in the persistent ADC session
+  * @param  pin : the pin to use
+  * @retval the value of the adc
+  */
+static uint16_t adc_session_read(PinName pin)
+{
+  uint32_t samplingTime = ADC_SAMPLINGTIME;
+  uint32_t channel = adc_session_prepare(pin, &samplingTime);
+  uint16_t value = 0;
+
+  if (channel == 0xFFFFFFFFU) {
+    return 0;
+  }
+  adc_session_scan(ADC_CHSELR_CHANNEL(channel), samplingTime, &value, 1);
+  return value;
+}
+
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+/**
+  * @brief  Start background conversions of a channel sequence into a
+  *         circular DMA buffer
+  * @note   The sequencer converts the channels in ascending channel order,
+  *         whatever the order of pins. Fails while a persistent session
+  *         (adc_session_begin()) is running: end it first. A running
+  *         watchdog is stopped, and adc_read_value() returns 0 until
+  *         adc_stream_stop().
+  * @param  pins : pins to convert, ADC1 channels or internal channels
+  * @param  count : number of pins
+  * @param  trigger : ADC_EXTERNALTRIGCONV_xxx to convert one sequence per
+  *         trigger event, or ADC_SOFTWARE_START for continuous conversions
+  * @param  buffer : destination buffer, one sample per channel and sequence
+  * @param  length : number of samples in buffer
+  * @param  callback : called from the DMA interrupt when the first (half=1)
+  *         or the second (half=0) half of buffer has been filled, can be NULL
+  * @retval 1 if the conversions are started, 0 otherwise
+  */
+uint8_t adc_stream_start(const PinName *pins, uint32_t count, uint32_t trigger,
+                         uint16_t *buffer, uint32_t length, void (*callback)(uint8_t half))
+{
+  ADC_ChannelConfTypeDef AdcChannelConf = {};
+  uint32_t samplingTime = ADC_SAMPLINGTIME;
+
+  if ((pins == NULL) || (count == 0) || (buffer == NULL) || (length == 0) ||
+      (g_adc_session_resolution != 0)) {
+    return 0;
+  }
+  adc_stream_stop();
+  adc_watchdog_stop();
+
+  /* Init and calibrate on the first pin, then switch to triggered/DMA mode */
+  g_adc_stream = {};
+  if (!adc_configure(&g_adc_stream, pins[0], 12)) {
+    return 0;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    if ((pins[i] & PADC_BASE) && (pins[i] < ANA_START)) {
+      samplingTime = ADC_SAMPLINGTIME_INTERNAL;
+    }
+  }
+  g_adc_stream.Init.ScanConvMode          = ADC_SCAN_DIRECTION_FORWARD;
+  g_adc_stream.Init.EOCSelection          = ADC_EOC_SEQ_CONV;
+  g_adc_stream.Init.ContinuousConvMode    = (trigger == ADC_SOFTWARE_START) ? ENABLE : DISABLE;
+  g_adc_stream.Init.ExternalTrigConv      = trigger;
+  g_adc_stream.Init.ExternalTrigConvEdge  = (trigger == ADC_SOFTWARE_START) ? ADC_EXTERNALTRIGCONVEDGE_NONE : ADC_EXTERNALTRIGCONVEDGE_RISING;
+  g_adc_stream.Init.DMAContinuousRequests = ENABLE;
+  g_adc_stream.Init.Overrun               = ADC_OVR_DATA_OVERWRITTEN;
+  g_adc_stream.Init.SamplingTimeCommon    = samplingTime;
+  if (HAL_ADC_Init(&g_adc_stream) != HAL_OK) {
+    HAL_ADC_DeInit(&g_adc_stream);
+    return 0;
+  }
+
+  AdcChannelConf.Rank         = ADC_RANK_CHANNEL_NUMBER;
+  AdcChannelConf.SamplingTime = samplingTime;
+  for (uint32_t i = 1; i < count; i++) {
+    uint32_t bank = 0;
+    if ((pins[i] & PADC_BASE) && (pins[i] < ANA_START)) {
+      AdcChannelConf.Channel = get_adc_internal_channel(pins[i]);
+    } else if ((ADC_TypeDef *)pinmap_peripheral(pins[i], PinMap_ADC) == g_adc_stream.Instance) {
+      AdcChannelConf.Channel = get_adc_channel(pins[i], &bank);
+      pinmap_pinout(pins[i], PinMap_ADC);
+    } else {
+      HAL_ADC_DeInit(&g_adc_stream);
+      return 0;
+    }
+    if (HAL_ADC_ConfigChannel(&g_adc_stream, &AdcChannelConf) != HAL_OK) {
+      HAL_ADC_DeInit(&g_adc_stream);
+      return 0;
+    }
+  }
+
+  g_adc_stream_dma = {};
+  if (dma_channel_claim(&g_adc_stream_dma) == NULL) {
+    HAL_ADC_DeInit(&g_adc_stream);
+    return 0;
+  }
+  g_adc_stream_dma.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  g_adc_stream_dma.Init.PeriphInc           = DMA_PINC_DISABLE;
+  g_adc_stream_dma.Init.MemInc              = DMA_MINC_ENABLE;
+  g_adc_stream_dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  g_adc_stream_dma.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+  g_adc_stream_dma.Init.Mode                = DMA_CIRCULAR;
+  g_adc_stream_dma.Init.Priority            = DMA_PRIORITY_HIGH;
+  if (HAL_DMA_Init(&g_adc_stream_dma) != HAL_OK) {
+    dma_channel_release(&g_adc_stream_dma);
+    HAL_ADC_DeInit(&g_adc_stream);
+    return 0;
+  }
+  HAL_DMA_ChannelMap(&g_adc_stream_dma, DMA_CHANNEL_MAP_ADC);
+  __HAL_LINKDMA(&g_adc_stream, DMA_Handle, g_adc_stream_dma);
+
+  g_adc_stream_callback = callback;
+  g_adc_stream_length = length;
+  g_adc_stream_running = 1;
+  if (HAL_ADC_Start_DMA(&g_adc_stream, (uint32_t *)buffer, length) != HAL_OK) {
+    adc_stream_stop();
+    return 0;
+  }
+  /* Overrun is harmless with DMA in circular mode, and the ADC vector is
+     shared with the comparators: do not keep its interrupt enabled. */
+  __HAL_ADC_DISABLE_IT(&g_adc_stream, ADC_IT_OVR);
+  return 1;
+}
+
+/**
+  * @brief  Stop the conversions started by adc_stream_start()
+  * @param  None
+  * @retval None
+  */
+void adc_stream_stop(void)
+{
+  if (g_adc_stream_running) {
+    g_adc_stream_running = 0;
+    HAL_ADC_Stop_DMA(&g_adc_stream);
+    dma_channel_release(&g_adc_stream_dma);
+    HAL_ADC_DeInit(&g_adc_stream);
+    if (__LL_ADC_COMMON_INSTANCE(g_adc_stream.Instance) != 0U) {
+      LL_ADC_SetCommonPathInternalCh(__LL_ADC_COMMON_INSTANCE(g_adc_stream.Instance), LL_ADC_PATH_INTERNAL_NONE);
+    }
+    g_adc_stream_callback = NULL;
+  }
+}
+
+/**
+  * @brief  Restart a stream from the start of its buffer
+  * @note   To be called with the trigger source stopped, e.g. between two
+  *         bursts: samples transferred since the last callback are dropped
+  *         and the next trigger fills the buffer from its first sample.
+  *         Safe from an interrupt: the wait for the ADC to stop is bounded
+  *         by ADC_STOP_LOOPS, not by HAL_GetTick().
+  * @param  None
+  * @retval 1 if restarted, 0 if not running or if the ADC did not stop; the
+  *         DMA is then disabled and the stream must be stopped
+  */
+uint8_t adc_stream_rewind(void)
+{
+  ADC_TypeDef *adc = g_adc_stream.Instance;
+  DMA_Channel_TypeDef *channel = g_adc_stream_dma.Instance;
+  uint32_t loops = ADC_STOP_LOOPS;
+
+  if (!g_adc_stream_running) {
+    return 0;
+  }
+  SET_BIT(adc->CR, ADC_CR_ADSTP);
+  while ((adc->CR & ADC_CR_ADSTART) != 0U) {
+    if (--loops == 0U) {
+      CLEAR_BIT(channel->CCR, DMA_CCR_EN);
+      return 0;
+    }
+  }
+  CLEAR_BIT(channel->CCR, DMA_CCR_EN);
+  channel->CNDTR = g_adc_stream_length;
+  g_adc_stream_dma.DmaBaseAddress->IFCR = (DMA_ISR_GIF1 << g_adc_stream_dma.ChannelIndex);
+  SET_BIT(channel->CCR, DMA_CCR_EN);
+  WRITE_REG(adc->ISR, ADC_ISR_EOC | ADC_ISR_EOSEQ | ADC_ISR_OVR);
+  SET_BIT(adc->CR, ADC_CR_ADSTART);
+  return 1;
+}
+
+/**
+  * @brief  Check if adc_stream_start() conversions are running
+  * @param  None
+  * @retval 1 if running, 0 otherwise
+  */
+uint8_t adc_stream_active(void)
+{
+  return g_adc_stream_running;
+}
+
+/**
+  * @brief  First half of the stream buffer filled
+  * @param  hadc : ADC handle
+  * @retval None
+  */
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  if ((hadc == &g_adc_stream) && (g_adc_stream_callback != NULL)) {
+    g_adc_stream_callback(1);
+  }
+}
+
+/**
+  * @brief  Second half of the stream buffer filled
+  * @param  hadc : ADC handle
+  * @retval None
+  */
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  if ((hadc == &g_adc_stream) && (g_adc_stream_callback != NULL)) {
+    g_adc_stream_callback(0);
+  }
+}
+#endif /* HAL_DMA_MODULE_ENABLED && DMA1_BASE */
+
+/**
+  * @brief  Convert a pin continuously and watch it with the analog watchdog
+  * @note   The ADC runs in continuous mode in the background, so a value out
+  *         of [low, high] is caught within one conversion time. The watchdog
+  *         is one-shot: after the callback it stays disarmed until
+  *         adc_watchdog_rearm(). adc_read_value() returns the latest
+  *         conversion for the watched pin and 0 for the other pins.
+  * @param  pin : the pin to watch, ADC1 channel or internal channel
+  * @param  low : low threshold, 12-bit
+  * @param  high : high threshold, 12-bit
+  * @param  callback : called from the ADC interrupt with the latest
+  *         conversion when the watchdog trips, can be NULL
+  * @retval 1 if the watchdog is running, 0 otherwise
+  */
+uint8_t adc_watchdog_start(PinName pin, uint16_t low, uint16_t high, void (*callback)(uint16_t value))
+{
+  ADC_AnalogWDGConfTypeDef AwdConf = {};
+  uint32_t bank = 0;
+
+  if ((low > high) || (high > 0xFFF)) {
+    return 0;
+  }
+  adc_watchdog_stop();
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+  adc_stream_stop();
+#endif
+  adc_session_end();
+
+  g_adc_watchdog = {};
+  if (!adc_configure(&g_adc_watchdog, pin, 12)) {
+    return 0;
+  }
+  g_adc_watchdog.Init.ContinuousConvMode = ENABLE;
+  g_adc_watchdog.Init.Overrun            = ADC_OVR_DATA_OVERWRITTEN;
+  if (HAL_ADC_Init(&g_adc_watchdog) != HAL_OK) {
+    HAL_ADC_DeInit(&g_adc_watchdog);
+    return 0;
+  }
+
+  AwdConf.WatchdogMode  = ADC_ANALOGWATCHDOG_SINGLE_REG;
+  if ((pin & PADC_BASE) && (pin < ANA_START)) {
+    AwdConf.Channel     = get_adc_internal_channel(pin);
+  } else {
+    AwdConf.Channel     = get_adc_channel(pin, &bank);
+  }
+  AwdConf.ITMode        = ENABLE;
+  AwdConf.HighThreshold = high;
+  AwdConf.LowThreshold  = low;
+  if (HAL_ADC_AnalogWDGConfig(&g_adc_watchdog, &AwdConf) != HAL_OK) {
+    HAL_ADC_DeInit(&g_adc_watchdog);
+    return 0;
+  }
+
+  g_adc_watchdog_callback = callback;
+  g_adc_watchdog_pin = pin;
+  if (HAL_ADC_Start(&g_adc_watchdog) != HAL_OK) {
+    adc_watchdog_stop();
+    return 0;
+  }
+  HAL_NVIC_SetPriority(ADC_COMP_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(ADC_COMP_IRQn);
+  return 1;
+}
+
+/**
+  * @brief  Arm the watchdog again, with new thresholds
+  * @param  low : low threshold, 12-bit
+  * @param  high : high threshold, 12-bit
+  * @retval 1 if armed, 0 otherwise
+  */
+uint8_t adc_watchdog_rearm(uint16_t low, uint16_t high)
+{
+  ADC_TypeDef *adc = g_adc_watchdog.Instance;
+  uint32_t tickstart;
+
+  if ((g_adc_watchdog_pin == NC) || (low > high) || (high > 0xFFF)) {
+    return 0;
+  }
+
+  /* Thresholds can only be written while no conversion is ongoing */
+  adc->CR |= ADC_CR_ADSTP;
+  tickstart = HAL_GetTick();
+  while ((adc->CR & ADC_CR_ADSTART) != 0U) {
+    if ((HAL_GetTick() - tickstart) > 2U) {
+      return 0;
+    }
+  }
+  adc->TR = ((uint32_t)high << ADC_TR_HT_Pos) | ((uint32_t)low << ADC_TR_LT_Pos);
+  adc->ISR = ADC_ISR_AWD | ADC_ISR_OVR;
+  adc->IER |= ADC_IER_AWDIE;
+  adc->CR |= ADC_CR_ADSTART;
+  return 1;
+}
+
+/**
+  * @brief  Stop the conversions started by adc_watchdog_start()
+  * @param  None
+  * @retval None
+  */
+void adc_watchdog_stop(void)
+{
+  if (g_adc_watchdog_pin != NC) {
+    __HAL_ADC_DISABLE_IT(&g_adc_watchdog, ADC_IT_AWD);
+    g_adc_watchdog_pin = NC;
+    g_adc_watchdog_callback = NULL;
+    HAL_ADC_Stop(&g_adc_watchdog);
+    HAL_ADC_DeInit(&g_adc_watchdog);
+    if (__LL_ADC_COMMON_INSTANCE(g_adc_watchdog.Instance) != 0U) {
+      LL_ADC_SetCommonPathInternalCh(__LL_ADC_COMMON_INSTANCE(g_adc_watchdog.Instance), LL_ADC_PATH_INTERNAL_NONE);
+    }
+  }
+}
+
+/**
+  * @brief  Check if adc_watchdog_start() conversions are running
+  * @param  None
+  * @retval 1 if running, 0 otherwise
+  */
+uint8_t adc_watchdog_active(void)
+{
+  return (g_adc_watchdog_pin != NC);
+}
+
+/**
+  * @brief  Check if the watchdog is armed, i.e. has not tripped yet
+  * @param  None
+  * @retval 1 if armed, 0 otherwise
+  */
+uint8_t adc_watchdog_armed(void)
+{
+  return (g_adc_watchdog_pin != NC) && ((g_adc_watchdog.Instance->IER & ADC_IER_AWDIE) != 0U);
+}
+
+/**
+  * @brief  Latest conversion of the watched pin
+  * @param  None
+  * @retval 12-bit value, 0 if the watchdog is not running
+  */
+uint16_t adc_watchdog_value(void)
+{
+  return (g_adc_watchdog_pin != NC) ? (uint16_t)g_adc_watchdog.Instance->DR : 0;
+}
+
+/**
+  * @brief  ADC part of the shared ADC/COMP interrupt
+  * @param  None
+  * @retval None
+  */
+void adc_irq_handler(void)
+{
+  ADC_TypeDef *adc = g_adc_watchdog.Instance;
+
+  if ((g_adc_watchdog_pin != NC) && ((adc->IER & ADC_IER_AWDIE) != 0U) &&
+      ((adc->ISR & ADC_ISR_AWD) != 0U)) {
+    uint16_t value = (uint16_t)adc->DR;
+    /* One-shot: an out of window level trips on every conversion */
+    adc->IER &= ~ADC_IER_AWDIE;
+    adc->ISR = ADC_ISR_AWD;
+    if (g_adc_watchdog_callback != NULL) {
+      g_adc_watchdog_callback(value);
+    }
+  }
+}
+
+/**
+  * @brief  Convert several pins with a single ADC setup and one scan
+  * @note   The ADC is configured and calibrated once for the whole batch
+  *         (the persistent session is used if it is running). The sampling
+  *         time is common to all channels on this ADC: ADC_SAMPLINGTIME, or
+  *         ADC_SAMPLINGTIME_INTERNAL if the batch includes internal channels.
+  * @param  pins : the pins to convert, in any order, duplicates allowed
+  * @param  out : one value per pin, in the order of pins
+  * @param  count : number of pins
+  * @param  resolution : resolution for converted data: 6/8/10/12
+  * @retval 1 if all pins are converted, 0 otherwise
+  */
+uint8_t adc_read_multi(const PinName *pins, uint16_t *out, uint32_t count, uint32_t resolution)
+{
+  uint32_t samplingTime = ADC_SAMPLINGTIME;
+  uint32_t channels[32];
+  uint16_t raw[32];
+  uint32_t chselr = 0;
+  uint32_t nb = 0;
+  uint8_t temporary = 0;
+  uint8_t status;
+
+  if ((pins == NULL) || (out == NULL) || (count == 0) || (count > 32) ||
+      (g_adc_watchdog_pin != NC)) {
+    return 0;
+  }
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+  if (g_adc_stream_running) {
+    return 0;
+  }
+#endif
+
+  if (g_adc_session_resolution != resolution) {
+    temporary = (g_adc_session_resolution == 0);
+    adc_session_end();
+    if (!adc_session_begin(resolution)) {
+      return 0;
+    }
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    channels[i] = adc_session_prepare(pins[i], &samplingTime);
+    if (channels[i] > 31U) {
+      if (temporary) {
+        adc_session_end();
+      }
+      return 0;
+    }
+    chselr |= ADC_CHSELR_CHANNEL(channels[i]);
+  }
+  for (uint32_t mask = chselr; mask != 0U; mask &= mask - 1U) {
+    nb++;
+  }
+
+  status = adc_session_scan(chselr, samplingTime, raw, nb);
+  if (status) {
+    for (uint32_t i = 0; i < count; i++) {
+      /* Rank of the channel in the ascending scan */
+      uint32_t rank = 0;
+      for (uint32_t mask = chselr & (ADC_CHSELR_CHANNEL(channels[i]) - 1U); mask != 0U; mask &= mask - 1U) {
+        rank++;
+      }
+      out[i] = raw[rank];
+    }
+  }
+
+  if (temporary) {
+    adc_session_end();
+  }
+  return status;
+}
+
+/**
+  * @brief  This function will set the ADC to the required value
+  * @param  pin : the pin to use
+  * @param  resolution : resolution for converted data: 6/8/10/12/14/16
+  * @retval the value of the adc
+  */
+uint16_t adc_read_value(PinName pin, uint32_t resolution)
+{
+  ADC_HandleTypeDef AdcHandle = {};
+  __IO uint16_t uhADCxConvertedValue = 0;
+
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+  if (g_adc_stream_running) {
+    /* The ADC is owned by a running stream */
+    return 0;
+  }
+#endif
+
+  if (g_adc_watchdog_pin != NC) {
+    /* The ADC converts the watched pin continuously */
+    if (pin != g_adc_watchdog_pin) {
+      return 0;
+    }
+    return (resolution < 12) ? (adc_watchdog_value() >> (12 - resolution)) : adc_watchdog_value();
+  }
+
+  if (g_adc_session_resolution != 0) {
+    if (g_adc_session_resolution != resolution) {
+      /* Resolution can only be changed while the ADC is disabled */
+      adc_session_end();
+      if (!adc_session_begin(resolution)) {
+        return 0;
+      }
+    }
+    return adc_session_read(pin);
+  }
+
+  if (!adc_configure(&AdcHandle, pin, resolution)) {
+    return 0;
+  }
+
   /*##-3- Start the conversion process ####################*/
   if (HAL_ADC_Start(&AdcHandle) != HAL_OK) {
     /* Start Conversion Error */
@@ -1053,6 +1750,89 @@ uint16_t adc_read_value(PinName pin, uint32_t resolution)
 #if defined(HAL_TIM_MODULE_ENABLED) && !defined(HAL_TIM_MODULE_ONLY)
 ////////////////////////// PWM INTERFACE FUNCTIONS /////////////////////////////
 
+/* analogWrite() fast path: state of the pins last started by pwm_start() */
+#ifndef PWM_CACHE_SIZE
+#define PWM_CACHE_SIZE 8
+#endif
+
+typedef struct {
+  PinName pin;
+  TIM_TypeDef *instance;
+  __IO uint32_t *ccr;
+  __IO uint32_t *ccmr;
+  uint32_t ocm;                       /* OCxM bits of the channel in PWM1 */
+  uint32_t ocmMask;
+  uint32_t ccer;                      /* CCxE/CCxNE bits of the channel */
+  uint32_t freq;
+  TimerCompareFormat_t resolution;
+  uint32_t arr;
+  uint32_t psc;
+} pwm_cache_t;
+
+static pwm_cache_t g_pwm_cache[PWM_CACHE_SIZE];
+static uint8_t g_pwm_cache_next = 0;
+
+static pwm_cache_t *pwm_cache_find(PinName pin)
+{
+  for (uint32_t i = 0; i < PWM_CACHE_SIZE; i++) {
+    if ((g_pwm_cache[i].instance != NULL) && (g_pwm_cache[i].pin == pin)) {
+      return &g_pwm_cache[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+  * @brief  Update the duty cycle of a running PWM pin by writing its CCRx
+  * @note   Only succeeds when pwm_start() already configured the pin with
+  *         the same frequency and resolution, the timer period has not
+  *         been changed since (e.g. by another channel of the same timer)
+  *         and the channel is still in PWM1 mode (not reconfigured through
+  *         HardwareTimer).
+  * @param  pin : the pin to use
+  * @param  PWM_freq : PWM frequency in Hz
+  * @param  value : duty cycle, in resolution bits
+  * @param  resolution : RESOLUTION_xB_COMPARE_FORMAT
+  * @retval 1 if CCRx was written, 0 if pwm_start() is needed
+  */
+uint8_t pwm_write_cached(PinName pin, uint32_t PWM_freq, uint32_t value, TimerCompareFormat_t resolution)
+{
+  pwm_cache_t *entry = pwm_cache_find(pin);
+  TIM_TypeDef *tim;
+  uint32_t ccr;
+
+  if ((entry == NULL) || (entry->freq != PWM_freq) || (entry->resolution != resolution)) {
+    return 0;
+  }
+  tim = entry->instance;
+  if ((tim->ARR != entry->arr) || (tim->PSC != entry->psc) || ((tim->CCER & entry->ccer) == 0U) ||
+      ((*entry->ccmr & entry->ocmMask) != entry->ocm)) {
+    return 0;
+  }
+
+  /* Same computation as HardwareTimer::setCaptureCompare() */
+  ccr = ((entry->arr + 1) * value) / ((1UL << resolution) - 1);
+  if ((entry->arr == 0xFFFFU) && (ccr == 0x10000U)) {
+    ccr = 0xFFFFU;
+  }
+  *entry->ccr = ccr;
+  return 1;
+}
+
+/**
+  * @brief  Forget the cached state of the pins of a timer
+  * @param  Instance : the timer
+  * @retval None
+  */
+static void pwm_cache_invalidate(TIM_TypeDef *Instance)
+{
+  for (uint32_t i = 0; i < PWM_CACHE_SIZE; i++) {
+    if (g_pwm_cache[i].instance == Instance) {
+      g_pwm_cache[i].instance = NULL;
+    }
+  }
+}
+
 /**
   * @brief  This function will set the PWM to the required value
   * @param  port : the gpio port to use
@@ -1063,6 +1843,11 @@ uint16_t adc_read_value(PinName pin, uint32_t resolution)
   */
 void pwm_start(PinName pin, uint32_t PWM_freq, uint32_t value, TimerCompareFormat_t resolution)
 {
+  if ((resolution >= RESOLUTION_1B_COMPARE_FORMAT) && (resolution <= RESOLUTION_16B_COMPARE_FORMAT) &&
+      pwm_write_cached(pin, PWM_freq, value, resolution)) {
+    return;
+  }
+
   TIM_TypeDef *Instance = (TIM_TypeDef *)pinmap_peripheral(pin, PinMap_TIM);
   HardwareTimer *HT;
   TimerModes_t previousMode;
@@ -1084,6 +1869,26 @@ void pwm_start(PinName pin, uint32_t PWM_freq, uint32_t value, TimerCompareForma
   if (previousMode != TIMER_OUTPUT_COMPARE_PWM1) {
     HT->resume();
   }
+
+  if ((resolution >= RESOLUTION_1B_COMPARE_FORMAT) && (resolution <= RESOLUTION_16B_COMPARE_FORMAT) &&
+      (channel >= 1) && (channel <= 4)) {
+    pwm_cache_t *entry = pwm_cache_find(pin);
+    if (entry == NULL) {
+      entry = &g_pwm_cache[g_pwm_cache_next];
+      g_pwm_cache_next = (g_pwm_cache_next + 1) % PWM_CACHE_SIZE;
+    }
+    entry->pin = pin;
+    entry->ccr = &Instance->CCR1 + (channel - 1);
+    entry->ccmr = (channel <= 2) ? &Instance->CCMR1 : &Instance->CCMR2;
+    entry->ocmMask = (channel & 1U) ? TIM_CCMR1_OC1M : TIM_CCMR1_OC2M;
+    entry->ocm = *entry->ccmr & entry->ocmMask;
+    entry->ccer = (TIM_CCER_CC1E | TIM_CCER_CC1NE) << (4 * (channel - 1));
+    entry->freq = PWM_freq;
+    entry->resolution = resolution;
+    entry->arr = Instance->ARR;
+    entry->psc = Instance->PSC;
+    entry->instance = Instance;
+  }
 }
 /**
   * @brief  This function will disable the PWM
@@ -1100,6 +1905,7 @@ void pwm_stop(PinName pin)
     HardwareTimer_Handle[index]->__this = new HardwareTimer((TIM_TypeDef *)pinmap_peripheral(pin, PinMap_TIM));
   }
 
+  pwm_cache_invalidate(Instance);
   HT = (HardwareTimer *)(HardwareTimer_Handle[index]->__this);
   if (HT != NULL) {
     delete (HT);
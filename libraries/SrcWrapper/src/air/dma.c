@@ -0,0 +1,165 @@
+/*
+ *******************************************************************************
+ * Copyright (c) 2024, AirM2M
+ * All rights reserved.
+ *
+ * This software component is licensed by AirM2M under BSD 3-Clause license,
+ * the "License"; You may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at:
+ *                        opensource.org/licenses/BSD-3-Clause
+ *
+ *******************************************************************************
+ */
+#include "dma.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if defined(HAL_DMA_MODULE_ENABLED) && defined(DMA1_BASE)
+
+/* Private Variables */
+static DMA_Channel_TypeDef *const dma_channels[DMA_CHANNEL_NUM] = {
+  DMA1_Channel1,
+  DMA1_Channel2,
+  DMA1_Channel3,
+#if defined(DMA1_Channel7_BASE)
+  DMA1_Channel4,
+  DMA1_Channel5,
+  DMA1_Channel6,
+  DMA1_Channel7,
+#endif
+};
+
+static DMA_HandleTypeDef *dma_handles[DMA_CHANNEL_NUM] = {NULL};
+
+/**
+  * @brief  Return the IRQ number of a DMA channel index
+  * @param  index: channel index, 0 for channel 1
+  * @retval IRQ number
+  */
+static IRQn_Type dma_channel_irq(uint32_t index)
+{
+  if (index == 0U) {
+    return DMA1_Channel1_IRQn;
+  }
+#if defined(DMA1_Channel7_BASE)
+  if (index >= 3U) {
+    return DMA1_Channel4_5_6_7_IRQn;
+  }
+#endif
+  return DMA1_Channel2_3_IRQn;
+}
+
+/**
+  * @brief  Claim a free DMA channel for a handle
+  * @note   Enables the DMA clock and the channel IRQ. hdma->Instance is set,
+  *         the caller then fills hdma->Init and calls HAL_DMA_Init().
+  * @param  hdma: DMA handle
+  * @retval channel or NULL if none is free
+  */
+DMA_Channel_TypeDef *dma_channel_claim(DMA_HandleTypeDef *hdma)
+{
+  DMA_Channel_TypeDef *channel = NULL;
+
+  if (hdma != NULL) {
+    __disable_irq();
+    for (uint32_t i = 0; i < DMA_CHANNEL_NUM; i++) {
+      if ((dma_handles[i] == NULL) || (dma_handles[i] == hdma)) {
+        dma_handles[i] = hdma;
+        channel = dma_channels[i];
+        __enable_irq();
+        __HAL_RCC_DMA_CLK_ENABLE();
+        hdma->Instance = channel;
+        HAL_NVIC_SetPriority(dma_channel_irq(i), DMA_IRQ_PRIO, DMA_IRQ_SUBPRIO);
+        HAL_NVIC_EnableIRQ(dma_channel_irq(i));
+        return channel;
+      }
+    }
+    __enable_irq();
+  }
+  return channel;
+}
+
+/**
+  * @brief  Release the DMA channel owned by a handle
+  * @note   The channel is aborted and de-initialized. The shared IRQ line is
+  *         only disabled when no other channel on it is in use.
+  * @param  hdma: DMA handle
+  * @retval None
+  */
+void dma_channel_release(DMA_HandleTypeDef *hdma)
+{
+  for (uint32_t i = 0; i < DMA_CHANNEL_NUM; i++) {
+    if ((hdma != NULL) && (dma_handles[i] == hdma)) {
+      HAL_DMA_Abort(hdma);
+      HAL_DMA_DeInit(hdma);
+      dma_handles[i] = NULL;
+
+      uint8_t shared = 0;
+      for (uint32_t j = 0; j < DMA_CHANNEL_NUM; j++) {
+        if ((dma_handles[j] != NULL) && (dma_channel_irq(j) == dma_channel_irq(i))) {
+          shared = 1;
+        }
+      }
+      if (shared == 0) {
+        HAL_NVIC_DisableIRQ(dma_channel_irq(i));
+      }
+      break;
+    }
+  }
+}
+
+/**
+  * @brief  Forward a channel interrupt to its handle
+  * @param  index: channel index, 0 for channel 1
+  * @retval None
+  */
+static inline void dma_channel_irq_handler(uint32_t index)
+{
+  if (dma_handles[index] != NULL) {
+    HAL_DMA_IRQHandler(dma_handles[index]);
+  }
+}
+
+/**
+  * @brief  DMA1 channel 1 IRQ handler
+  * @param  None
+  * @retval None
+  */
+void DMA1_Channel1_IRQHandler(void)
+{
+  dma_channel_irq_handler(0);
+}
+
+/**
+  * @brief  DMA1 channel 2 and 3 IRQ handler
+  * @param  None
+  * @retval None
+  */
+void DMA1_Channel2_3_IRQHandler(void)
+{
+  dma_channel_irq_handler(1);
+  dma_channel_irq_handler(2);
+}
+
+#if defined(DMA1_Channel7_BASE)
+/**
+  * @brief  DMA1 channel 4 to 7 IRQ handler
+  * @param  None
+  * @retval None
+  */
+void DMA1_Channel4_5_6_7_IRQHandler(void)
+{
+  dma_channel_irq_handler(3);
+  dma_channel_irq_handler(4);
+  dma_channel_irq_handler(5);
+  dma_channel_irq_handler(6);
+}
+#endif
+
+#endif /* HAL_DMA_MODULE_ENABLED && DMA1_BASE */
+#ifdef __cplusplus
+}
+#endif
+
+/************************ (C) COPYRIGHT AirM2M *****END OF FILE****/
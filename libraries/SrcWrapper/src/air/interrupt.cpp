@@ -8,7 +8,9 @@
 /*As we can have only one interrupt/pin id, don't need to get the port info*/
 typedef struct {
   IRQn_Type irqnb;
-  std::function<void(void)> callback;
+  void (*callback)(void *arg);
+  void *arg;
+  void (*release)(void *arg);  // frees arg when the callback is replaced, if set
 } gpio_irq_conf_str;
 
 /* Private_Defines */
@@ -17,56 +19,56 @@ typedef struct {
 /* Private Variables */
 static gpio_irq_conf_str gpio_irq_conf[NB_EXTI] = {
 #if defined (AIR32C0xx) || defined (PY32F0xx) || defined (AIR32G0xx) || defined (AIR32L0xx)
-  {.irqnb = EXTI0_1_IRQn,   .callback = NULL}, //GPIO_PIN_0
-  {.irqnb = EXTI0_1_IRQn,   .callback = NULL}, //GPIO_PIN_1
-  {.irqnb = EXTI2_3_IRQn,   .callback = NULL}, //GPIO_PIN_2
-  {.irqnb = EXTI2_3_IRQn,   .callback = NULL}, //GPIO_PIN_3
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_4
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_5
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_6
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_7
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_8
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_9
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_10
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_11
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_12
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_13
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}, //GPIO_PIN_14
-  {.irqnb = EXTI4_15_IRQn,  .callback = NULL}  //GPIO_PIN_15
+  {.irqnb = EXTI0_1_IRQn,   .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_0
+  {.irqnb = EXTI0_1_IRQn,   .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_1
+  {.irqnb = EXTI2_3_IRQn,   .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_2
+  {.irqnb = EXTI2_3_IRQn,   .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_3
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_4
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_5
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_6
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_7
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_8
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_9
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_10
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_11
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_12
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_13
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_14
+  {.irqnb = EXTI4_15_IRQn,  .callback = NULL, .arg = NULL, .release = NULL}  //GPIO_PIN_15
 #elif defined (AIR32MP1xx) || defined (AIR32L5xx) || defined (AIR32U5xx)
-  {.irqnb = EXTI0_IRQn,     .callback = NULL}, //GPIO_PIN_0
-  {.irqnb = EXTI1_IRQn,     .callback = NULL}, //GPIO_PIN_1
-  {.irqnb = EXTI2_IRQn,     .callback = NULL}, //GPIO_PIN_2
-  {.irqnb = EXTI3_IRQn,     .callback = NULL}, //GPIO_PIN_3
-  {.irqnb = EXTI4_IRQn,     .callback = NULL}, //GPIO_PIN_4
-  {.irqnb = EXTI5_IRQn,     .callback = NULL}, //GPIO_PIN_5
-  {.irqnb = EXTI6_IRQn,     .callback = NULL}, //GPIO_PIN_6
-  {.irqnb = EXTI7_IRQn,     .callback = NULL}, //GPIO_PIN_7
-  {.irqnb = EXTI8_IRQn,     .callback = NULL}, //GPIO_PIN_8
-  {.irqnb = EXTI9_IRQn,     .callback = NULL}, //GPIO_PIN_9
-  {.irqnb = EXTI10_IRQn,    .callback = NULL}, //GPIO_PIN_10
-  {.irqnb = EXTI11_IRQn,    .callback = NULL}, //GPIO_PIN_11
-  {.irqnb = EXTI12_IRQn,    .callback = NULL}, //GPIO_PIN_12
-  {.irqnb = EXTI13_IRQn,    .callback = NULL}, //GPIO_PIN_13
-  {.irqnb = EXTI14_IRQn,    .callback = NULL}, //GPIO_PIN_14
-  {.irqnb = EXTI15_IRQn,    .callback = NULL}  //GPIO_PIN_15
+  {.irqnb = EXTI0_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_0
+  {.irqnb = EXTI1_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_1
+  {.irqnb = EXTI2_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_2
+  {.irqnb = EXTI3_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_3
+  {.irqnb = EXTI4_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_4
+  {.irqnb = EXTI5_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_5
+  {.irqnb = EXTI6_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_6
+  {.irqnb = EXTI7_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_7
+  {.irqnb = EXTI8_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_8
+  {.irqnb = EXTI9_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_9
+  {.irqnb = EXTI10_IRQn,    .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_10
+  {.irqnb = EXTI11_IRQn,    .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_11
+  {.irqnb = EXTI12_IRQn,    .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_12
+  {.irqnb = EXTI13_IRQn,    .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_13
+  {.irqnb = EXTI14_IRQn,    .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_14
+  {.irqnb = EXTI15_IRQn,    .callback = NULL, .arg = NULL, .release = NULL}  //GPIO_PIN_15
 #else
-  {.irqnb = EXTI0_IRQn,     .callback = NULL}, //GPIO_PIN_0
-  {.irqnb = EXTI1_IRQn,     .callback = NULL}, //GPIO_PIN_1
-  {.irqnb = EXTI2_IRQn,     .callback = NULL}, //GPIO_PIN_2
-  {.irqnb = EXTI3_IRQn,     .callback = NULL}, //GPIO_PIN_3
-  {.irqnb = EXTI4_IRQn,     .callback = NULL}, //GPIO_PIN_4
-  {.irqnb = EXTI9_5_IRQn,   .callback = NULL}, //GPIO_PIN_5
-  {.irqnb = EXTI9_5_IRQn,   .callback = NULL}, //GPIO_PIN_6
-  {.irqnb = EXTI9_5_IRQn,   .callback = NULL}, //GPIO_PIN_7
-  {.irqnb = EXTI9_5_IRQn,   .callback = NULL}, //GPIO_PIN_8
-  {.irqnb = EXTI9_5_IRQn,   .callback = NULL}, //GPIO_PIN_9
-  {.irqnb = EXTI15_10_IRQn, .callback = NULL}, //GPIO_PIN_10
-  {.irqnb = EXTI15_10_IRQn, .callback = NULL}, //GPIO_PIN_11
-  {.irqnb = EXTI15_10_IRQn, .callback = NULL}, //GPIO_PIN_12
-  {.irqnb = EXTI15_10_IRQn, .callback = NULL}, //GPIO_PIN_13
-  {.irqnb = EXTI15_10_IRQn, .callback = NULL}, //GPIO_PIN_14
-  {.irqnb = EXTI15_10_IRQn, .callback = NULL}  //GPIO_PIN_15
+  {.irqnb = EXTI0_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_0
+  {.irqnb = EXTI1_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_1
+  {.irqnb = EXTI2_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_2
+  {.irqnb = EXTI3_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_3
+  {.irqnb = EXTI4_IRQn,     .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_4
+  {.irqnb = EXTI9_5_IRQn,   .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_5
+  {.irqnb = EXTI9_5_IRQn,   .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_6
+  {.irqnb = EXTI9_5_IRQn,   .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_7
+  {.irqnb = EXTI9_5_IRQn,   .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_8
+  {.irqnb = EXTI9_5_IRQn,   .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_9
+  {.irqnb = EXTI15_10_IRQn, .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_10
+  {.irqnb = EXTI15_10_IRQn, .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_11
+  {.irqnb = EXTI15_10_IRQn, .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_12
+  {.irqnb = EXTI15_10_IRQn, .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_13
+  {.irqnb = EXTI15_10_IRQn, .callback = NULL, .arg = NULL, .release = NULL}, //GPIO_PIN_14
+  {.irqnb = EXTI15_10_IRQn, .callback = NULL, .arg = NULL, .release = NULL}  //GPIO_PIN_15
 #endif
 };
 
@@ -94,7 +96,49 @@ static uint8_t get_pin_id(uint16_t pin)
 
   return id;
 }
-void air_interrupt_enable(GPIO_TypeDef *port, uint16_t pin, callback_function_t callback, uint32_t mode)
+/**
+  * @brief  Store the callback of a line, releasing the previous argument
+  * @param  id : EXTI line
+  * @param  callback : callback, NULL to remove it
+  * @param  arg : argument given to the callback
+  * @param  release : called with arg when the callback is replaced, if not NULL
+  * @retval None
+  */
+static void set_callback(uint8_t id, void (*callback)(void *arg), void *arg, void (*release)(void *arg))
+{
+  void *previous_arg = gpio_irq_conf[id].arg;
+  void (*previous_release)(void *arg) = gpio_irq_conf[id].release;
+
+  // The interrupt must not see a callback with another callback's argument
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  gpio_irq_conf[id].callback = callback;
+  gpio_irq_conf[id].arg = arg;
+  gpio_irq_conf[id].release = release;
+  __set_PRIMASK(primask);
+
+  if (previous_release != NULL) {
+    previous_release(previous_arg);
+  }
+}
+
+static void call_plain(void *arg)
+{
+  ((void (*)(void))arg)();
+}
+
+/**
+  * @brief  This function enable the interruption on the selected port/pin
+  * @param  port : one of the gpio port
+  * @param  pin : one of the gpio pin
+  * @param  callback : callback to call when the interrupt falls, with arg
+  * @param  arg : argument given to the callback
+  * @param  release : called with arg when the callback is replaced or removed, may be NULL
+  * @param  mode : one of the supported interrupt mode defined in AIR32_hal_gpio
+  * @retval None
+  */
+void air_interrupt_enable_arg(GPIO_TypeDef *port, uint16_t pin, void (*callback)(void *arg), void *arg,
+                              void (*release)(void *arg), uint32_t mode)
 {
   GPIO_InitTypeDef GPIO_InitStruct;
   uint8_t id = get_pin_id(pin);
@@ -154,7 +198,7 @@ void air_interrupt_enable(GPIO_TypeDef *port, uint16_t pin, callback_function_t
 
   hsem_unlock(CFG_HW_GPIO_SEMID);
 
-  gpio_irq_conf[id].callback = callback;
+  set_callback(id, callback, arg, release);
 
   // Enable and set EXTI Interrupt
   HAL_NVIC_SetPriority(gpio_irq_conf[id].irqnb, EXTI_IRQ_PRIO, EXTI_IRQ_SUBPRIO);
@@ -171,9 +215,11 @@ void air_interrupt_enable(GPIO_TypeDef *port, uint16_t pin, callback_function_t
   */
 void air_interrupt_enable(GPIO_TypeDef *port, uint16_t pin, void (*callback)(void), uint32_t mode)
 {
-  std::function<void(void)> _c = callback;
-  air_interrupt_enable(port, pin, _c, mode);
-
+  if (callback == NULL) {
+    air_interrupt_enable_arg(port, pin, NULL, NULL, NULL, mode);
+  } else {
+    air_interrupt_enable_arg(port, pin, call_plain, (void *)callback, NULL, mode);
+  }
 }
 
 /**
@@ -186,7 +232,7 @@ void air_interrupt_disable(GPIO_TypeDef *port, uint16_t pin)
 {
   UNUSED(port);
   uint8_t id = get_pin_id(pin);
-  gpio_irq_conf[id].callback = NULL;
+  set_callback(id, NULL, NULL, NULL);
 
   for (int i = 0; i < NB_EXTI; i++) {
     if (gpio_irq_conf[id].irqnb == gpio_irq_conf[i].irqnb
@@ -212,7 +258,7 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
   uint8_t irq_id = get_pin_id(GPIO_Pin);
 
   if (gpio_irq_conf[irq_id].callback != NULL) {
-    gpio_irq_conf[irq_id].callback();
+    gpio_irq_conf[irq_id].callback(gpio_irq_conf[irq_id].arg);
   }
 }
 
@@ -238,6 +284,38 @@ void HAL_GPIO_EXTI_Falling_Callback(uint16_t GPIO_Pin)
 }
 #endif
 
+#if defined(PY32F0xx)
+/* Index of the single set bit of a word: de Bruijn multiply and lookup,
+ * the Cortex-M0+ has no count-leading-zeros instruction. */
+static const uint8_t debruijn_bit_index[32] = {
+  0,  1,  28, 2,  29, 14, 24, 3,  30, 22, 20, 15, 25, 17, 4,  8,
+  31, 27, 13, 23, 21, 19, 16, 7,  26, 12, 18, 6,  11, 5,  10, 9
+};
+
+/**
+  * @brief  Dispatch the pending EXTI lines of a shared handler: the pending
+  *         register is read once, the lines are cleared with one write and
+  *         only the set bits are walked, lowest line first
+  * @param  lines : EXTI lines served by the handler
+  * @retval None
+  */
+static inline void exti_dispatch(uint32_t lines)
+{
+  uint32_t pending = EXTI->PR & lines;
+
+  EXTI->PR = pending;
+  while (pending != 0) {
+    uint32_t bit = pending & (0U - pending);
+    gpio_irq_conf_str *conf = &gpio_irq_conf[debruijn_bit_index[(bit * 0x077CB531U) >> 27]];
+
+    pending ^= bit;
+    if (conf->callback != NULL) {
+      conf->callback(conf->arg);
+    }
+  }
+}
+#endif /* PY32F0xx */
+
 #if defined (AIR32C0xx) || defined(PY32F0xx) || defined (AIR32G0xx) || defined (AIR32L0xx)
 #ifdef __cplusplus
 extern "C" {
@@ -250,10 +328,14 @@ extern "C" {
   */
 void EXTI0_1_IRQHandler(void)
 {
+#if defined(PY32F0xx)
+  exti_dispatch(GPIO_PIN_0 | GPIO_PIN_1);
+#else
   uint32_t pin;
   for (pin = GPIO_PIN_0; pin <= GPIO_PIN_1; pin = pin << 1) {
     HAL_GPIO_EXTI_IRQHandler(pin);
   }
+#endif
 }
 
 
@@ -264,10 +346,14 @@ void EXTI0_1_IRQHandler(void)
   */
 void EXTI2_3_IRQHandler(void)
 {
+#if defined(PY32F0xx)
+  exti_dispatch(GPIO_PIN_2 | GPIO_PIN_3);
+#else
   uint32_t pin;
   for (pin = GPIO_PIN_2; pin <= GPIO_PIN_3; pin = pin << 1) {
     HAL_GPIO_EXTI_IRQHandler(pin);
   }
+#endif
 }
 
 /**
@@ -277,10 +363,14 @@ void EXTI2_3_IRQHandler(void)
   */
 void EXTI4_15_IRQHandler(void)
 {
+#if defined(PY32F0xx)
+  exti_dispatch(0xFFF0U);  // GPIO_PIN_4 .. GPIO_PIN_15
+#else
   uint32_t pin;
   for (pin = GPIO_PIN_4; pin <= GPIO_PIN_15; pin = pin << 1) {
     HAL_GPIO_EXTI_IRQHandler(pin);
   }
+#endif
 }
 #ifdef __cplusplus
 }
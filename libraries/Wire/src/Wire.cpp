@@ -31,18 +31,50 @@ extern "C" {
 // 0x01 is a reserved value, and thus cannot be used by slave devices
 static const uint8_t MASTER_ADDRESS = 0x01;
 
+// Bus recovery states, see pollBus()
+enum {
+  BUS_RECOVERY_IDLE = 0,
+  BUS_RECOVERY_CLOCK,
+  BUS_RECOVERY_STOP,
+  BUS_RECOVERY_RESET
+};
+// Half period of the recovery clock in microseconds (~100 kHz)
+#define BUS_RECOVERY_HALF_PERIOD_US 5U
+// Up to 9 clocks are needed for a slave to release SDA
+#define BUS_RECOVERY_CLOCKS         9U
+
 // Constructors ////////////////////////////////////////////////////////////////
 
 TwoWire::TwoWire()
 {
   _i2c.sda = digitalPinToPinName(SDA);
   _i2c.scl = digitalPinToPinName(SCL);
+#if defined(PY32F0xx)
+  _i2c.timingValue = 0;
+  _i2c.stallUs = 0;
+#endif
+  busWatchdogUs = 0;
+  busStallCount = 0;
+  busRecoveryState = BUS_RECOVERY_IDLE;
+  pecEnabled = false;
+  pecPrefixValid = false;
+  pecErrorCount = 0;
 }
 
 TwoWire::TwoWire(uint32_t sda, uint32_t scl)
 {
   _i2c.sda = digitalPinToPinName(sda);
   _i2c.scl = digitalPinToPinName(scl);
+#if defined(PY32F0xx)
+  _i2c.timingValue = 0;
+  _i2c.stallUs = 0;
+#endif
+  busWatchdogUs = 0;
+  busStallCount = 0;
+  busRecoveryState = BUS_RECOVERY_IDLE;
+  pecEnabled = false;
+  pecPrefixValid = false;
+  pecErrorCount = 0;
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -126,6 +158,13 @@ void TwoWire::setClock(uint32_t frequency)
   }
 }
 
+#if defined(PY32F0xx)
+void TwoWire::setClockTiming(uint32_t timing)
+{
+  i2c_setTimingValue(&_i2c, timing);
+}
+#endif
+
 uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint32_t iaddress, uint8_t isize, uint8_t sendStop)
 {
 #if !defined(I2C_OTHER_FRAME) && !defined(PY32F0xx)
@@ -133,8 +172,10 @@ uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint32_t iaddres
 #endif
   uint8_t read = 0;
 
-  if (_i2c.isMaster == 1) {
-    allocateRxBuffer(quantity);
+  if ((_i2c.isMaster == 1) && checkBus()) {
+    // keep room for the PEC byte, none on zero-length quick reads
+    bool pec = pecEnabled && (quantity != 0);
+    allocateRxBuffer(pec ? quantity + 1 : quantity);
 
     if (isize > 0) {
       // send internal address; this mode allows sending a repeated start to access
@@ -164,10 +205,25 @@ uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint32_t iaddres
     }
 #endif
 
-    if (I2C_OK == i2c_master_read(&_i2c, address << 1, rxBuffer, quantity)) {
+    i2c_status_e status = i2c_master_read(&_i2c, address << 1, rxBuffer, pec ? quantity + 1 : quantity);
+    if (I2C_OK == status) {
       read = quantity;
+#if defined(CRC_BASE)
+      if (pec) {
+        uint8_t addr = (address << 1) | 1;
+        uint8_t crc = HardwareCRC::crc8(&addr, 1, 0x07, pecPrefixValid ? pecPrefix : 0);
+        if (HardwareCRC::crc8(rxBuffer, quantity, 0x07, crc) != rxBuffer[quantity]) {
+          pecErrorCount++;
+          read = 0;
+        }
+      }
+#endif
+    } else if ((busWatchdogUs != 0) && ((status == I2C_TIMEOUT) || (status == I2C_BUSY))) {
+      startBusRecovery();
     }
 
+    pecPrefixValid = false;
+
     // set rx buffer iterator vars
     rxBufferIndex = 0;
     rxBufferLength = read;
@@ -245,8 +301,24 @@ uint8_t TwoWire::endTransmission(uint8_t sendStop)
 #endif
 
   if (_i2c.isMaster == 1) {
+#if defined(CRC_BASE)
+    pecPrefixValid = false;
+    // no PEC on quick commands / address probes (no data byte)
+    if (pecEnabled && (txDataSize != 0)) {
+      uint8_t pec = HardwareCRC::crc8(&txAddress, 1);
+      pec = HardwareCRC::crc8(txBuffer, txDataSize, 0x07, pec);
+      if (sendStop == 0) {
+        // repeated start follows: the PEC is sent at the end of the read
+        pecPrefix = pec;
+        pecPrefixValid = true;
+      } else {
+        write(pec);
+      }
+    }
+#endif
     // transmit buffer (blocking)
-    switch (i2c_master_write(&_i2c, txAddress, txBuffer, txDataSize)) {
+    i2c_status_e status = checkBus() ? i2c_master_write(&_i2c, txAddress, txBuffer, txDataSize) : I2C_BUSY;
+    switch (status) {
       case I2C_OK :
         ret = 0; // Success
         break;
@@ -261,6 +333,11 @@ uint8_t TwoWire::endTransmission(uint8_t sendStop)
         break;
       case I2C_TIMEOUT:
       case I2C_BUSY:
+        if ((busWatchdogUs != 0) && (busRecoveryState == BUS_RECOVERY_IDLE)) {
+          startBusRecovery();
+        }
+        ret = 4;
+        break;
       case I2C_ERROR:
       default:
         ret = 4;
@@ -534,6 +611,127 @@ void TwoWire::recoverBus(void)
   }
 }
 
+/**
+  * @brief  Enable the bus watchdog
+  * @param  timeoutUs: time allowed for the bus to become idle before a
+  *         transfer, 0 disables the watchdog. It is also the clock
+  *         stretching allowed during a transfer, on top of the time its
+  *         length takes at the bus speed (see i2c_master_write()).
+  */
+void TwoWire::setBusWatchdog(uint32_t timeoutUs)
+{
+  busWatchdogUs = timeoutUs;
+#if defined(PY32F0xx)
+  _i2c.stallUs = timeoutUs;
+#endif
+}
+
+/**
+  * @brief  Check the bus before a master transfer
+  * @note   Always true when the watchdog is disabled. Otherwise waits at most
+  *         busWatchdogUs for the bus to be idle, then counts a stall and
+  *         starts the background recovery.
+  * @retval true if the transfer can be started
+  */
+bool TwoWire::checkBus(void)
+{
+  if (busWatchdogUs == 0) {
+    return true;
+  }
+  if (!pollBus()) {
+    return false;
+  }
+  uint32_t start = micros();
+  while (!i2c_isBusIdle(&_i2c)) {
+    if ((micros() - start) >= busWatchdogUs) {
+      startBusRecovery();
+      return false;
+    }
+  }
+  return true;
+}
+
+void TwoWire::startBusRecovery(void)
+{
+  busStallCount++;
+  i2c_deinit(&_i2c);
+  // Lines are driven as open drain, a slave can still stretch the clock
+  digitalWriteFast(_i2c.scl, HIGH);
+  digitalWriteFast(_i2c.sda, HIGH);
+  pinMode(pinNametoDigitalPin(_i2c.scl), OUTPUT_OPEN_DRAIN);
+  pinMode(pinNametoDigitalPin(_i2c.sda), OUTPUT_OPEN_DRAIN);
+  busRecoveryStep = 0;
+  busRecoveryTime = micros();
+  busRecoveryState = BUS_RECOVERY_CLOCK;
+}
+
+/**
+  * @brief  Advance the bus recovery by at most one half clock period
+  * @note   Never blocks. Clocks SCL until the slave releases SDA (up to 9
+  *         clocks), sends a STOP condition then resets the I2C peripheral
+  *         through i2c_deinit()/i2c_custom_init().
+  * @retval true if the bus is available (no recovery in progress)
+  */
+bool TwoWire::pollBus(void)
+{
+  if (busRecoveryState == BUS_RECOVERY_IDLE) {
+    return true;
+  }
+  uint32_t now = micros();
+  if ((now - busRecoveryTime) < BUS_RECOVERY_HALF_PERIOD_US) {
+    return false;
+  }
+  busRecoveryTime = now;
+
+  switch (busRecoveryState) {
+    case BUS_RECOVERY_CLOCK:
+      // Even steps drive SCL low, odd steps release it
+      if ((busRecoveryStep & 1U) == 0) {
+        digitalWriteFast(_i2c.scl, LOW);
+      } else {
+        digitalWriteFast(_i2c.scl, HIGH);
+      }
+      busRecoveryStep++;
+      if (((busRecoveryStep & 1U) == 0) &&
+          ((digitalReadFast(_i2c.sda) == HIGH) || (busRecoveryStep >= (2U * BUS_RECOVERY_CLOCKS)))) {
+        busRecoveryStep = 0;
+        busRecoveryState = BUS_RECOVERY_STOP;
+      }
+      break;
+    case BUS_RECOVERY_STOP:
+      // SCL low, SDA low, SCL high, SDA high: STOP condition
+      switch (busRecoveryStep++) {
+        case 0:
+          digitalWriteFast(_i2c.scl, LOW);
+          break;
+        case 1:
+          digitalWriteFast(_i2c.sda, LOW);
+          break;
+        case 2:
+          digitalWriteFast(_i2c.scl, HIGH);
+          break;
+        default:
+          digitalWriteFast(_i2c.sda, HIGH);
+          busRecoveryState = BUS_RECOVERY_RESET;
+          break;
+      }
+      break;
+    case BUS_RECOVERY_RESET:
+    default:
+      pinMode(pinNametoDigitalPin(_i2c.scl), INPUT);
+      pinMode(pinNametoDigitalPin(_i2c.sda), INPUT);
+      // Restore the peripheral with the speed used before the stall
+#ifdef PY32F0xx
+      i2c_custom_init(&_i2c, _i2c.handle.Init.ClockSpeed, 0x00, ownAddress);
+#else
+      i2c_custom_init(&_i2c, _i2c.handle.Init.ClockSpeed, I2C_ADDRESSINGMODE_7BIT, ownAddress);
+#endif
+      busRecoveryState = BUS_RECOVERY_IDLE;
+      break;
+  }
+  return busRecoveryState == BUS_RECOVERY_IDLE;
+}
+
 // Preinstantiate Objects //////////////////////////////////////////////////////
 
 TwoWire Wire = TwoWire(); //
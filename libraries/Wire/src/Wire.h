@@ -75,6 +75,22 @@ class TwoWire : public Stream {
     void resetTxBuffer(void);
     void recoverBus(void);
 
+    // Bus watchdog, see setBusWatchdog()
+    uint32_t busWatchdogUs;
+    uint32_t busStallCount;
+    uint32_t busRecoveryTime;
+    uint8_t busRecoveryState;
+    uint8_t busRecoveryStep;
+
+    bool checkBus(void);
+    void startBusRecovery(void);
+
+    // SMBus PEC, see setPEC()
+    bool pecEnabled;
+    bool pecPrefixValid;
+    uint8_t pecPrefix;
+    uint32_t pecErrorCount;
+
   public:
     TwoWire();
     TwoWire(uint32_t sda, uint32_t scl);
@@ -101,6 +117,11 @@ class TwoWire : public Stream {
     void begin(int, bool generalCall = false, bool NoStretchMode = false);
     void end();
     void setClock(uint32_t);
+#if defined(PY32F0xx)
+    // Apply a timing word built with I2C_TIMING_VALUE(pclk, speed), e.g. a
+    // constexpr computed at build time. begin() has to be called before.
+    void setClockTiming(uint32_t);
+#endif
     void beginTransmission(uint8_t);
     void beginTransmission(int);
     uint8_t endTransmission(void);
@@ -118,6 +139,39 @@ class TwoWire : public Stream {
     virtual int peek(void);
     virtual void flush(void);
 
+    // Bus watchdog (master only): a stuck SDA/SCL line or BUSY flag is
+    // detected within timeoutUs, the transfer fails immediately and the bus is
+    // recovered in the background (clock pulses, STOP, peripheral reset).
+    // Recovery progresses on each transfer attempt and on pollBus(), which can
+    // be called from loop(). A transfer in progress may stretch the clock for
+    // timeoutUs beyond its own duration. 0 disables the watchdog (default).
+    void setBusWatchdog(uint32_t timeoutUs);
+    bool pollBus(void);
+    bool isBusRecovering(void)
+    {
+      return busRecoveryState != 0;
+    };
+    uint32_t getBusStallCount(void)
+    {
+      return busStallCount;
+    };
+
+#if defined(CRC_BASE)
+    // SMBus Packet Error Code (master only): endTransmission() appends the
+    // CRC-8 (poly 0x07) of address and data, requestFrom() reads one more
+    // byte and checks it, including the command sent by a preceding
+    // endTransmission(false). A mismatch makes requestFrom() return 0.
+    void setPEC(bool enable)
+    {
+      pecEnabled = enable;
+      pecPrefixValid = false;
+    };
+    uint32_t getPECErrorCount(void)
+    {
+      return pecErrorCount;
+    };
+#endif
+
     void onReceive(cb_function_receive_t callback);
     void onRequest(cb_function_request_t callback);
 
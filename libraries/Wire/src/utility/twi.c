@@ -38,6 +38,7 @@
 #include "core_debug.h"
 #include "utility/twi.h"
 #include "PinAF_AIRF1.h"
+#include "digital_io.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,6 +50,11 @@ extern "C" {
 #define I2C_TIMEOUT_TICK        100
 #endif
 
+/// @brief Blocking transfer timeout in tick unit
+#ifndef I2C_XFER_TIMEOUT_TICK
+#define I2C_XFER_TIMEOUT_TICK   1000
+#endif
+
 #define SLAVE_MODE_TRANSMIT     0
 #define SLAVE_MODE_RECEIVE      1
 #define SLAVE_MODE_LISTEN       2
@@ -154,6 +160,23 @@ static const I2C_Charac_t I2C_Charac[] = {
 };
 #endif /* I2C_TIMING */
 
+#if defined(PY32F0xx)
+typedef enum {
+  I2C_SPEED_FREQ_STANDARD,  /* 100 kHz */
+  I2C_SPEED_FREQ_FAST,      /* 400 kHz */
+  I2C_SPEED_FREQ_FAST_PLUS, /* 1 MHz */
+  I2C_SPEED_FREQ_NUMBER     /* Must be the last entry */
+} I2C_speed_freq_t;
+
+typedef struct {
+  uint32_t input_clock;      /* I2C Input clock (PCLK) */
+  uint32_t timing;           /* Packed CR2/TRISE/CCR value for this input clock */
+} I2C_timing_t;
+
+/* Runtime cache keyed by (PCLK, speed): one slot per supported speed */
+static I2C_timing_t I2C_ClockTiming[I2C_SPEED_FREQ_NUMBER] = {0};
+#endif /* PY32F0xx */
+
 /*  Family specific description for I2C */
 typedef enum {
 #if defined(I2C1_BASE) || (defined(PY32F0xx) && defined(I2C_BASE))
@@ -630,6 +653,105 @@ static uint32_t i2c_getTiming(i2c_t *obj, uint32_t frequency)
   return ret;
 }
 
+#if defined(PY32F0xx)
+/**
+* @brief  Return the packed timing word for a normalized speed.
+* @note   The value is computed once per (PCLK, speed) pair and then served
+*         from I2C_ClockTiming. A variant may also provide fixed values
+*         through I2C_TIMING_SM/I2C_TIMING_FM/I2C_TIMING_FMP, built with
+*         I2C_TIMING_VALUE().
+* @param  i2c_speed : 100000, 400000 or 1000000 (see i2c_getTiming())
+* @retval packed timing, see I2C_TIMING_VALUE()
+*/
+static uint32_t i2c_getTimingValue(uint32_t i2c_speed)
+{
+  uint32_t index;
+  uint32_t speed;
+
+  switch (i2c_speed) {
+    default:
+    /* Not a normalized speed (e.g. 0 from i2c_getTiming()): standard mode */
+    case 100000:
+#ifdef I2C_TIMING_SM
+      return I2C_TIMING_SM;
+#else
+      index = I2C_SPEED_FREQ_STANDARD;
+      speed = 100000;
+      break;
+#endif
+    case 400000:
+#ifdef I2C_TIMING_FM
+      return I2C_TIMING_FM;
+#else
+      index = I2C_SPEED_FREQ_FAST;
+      speed = 400000;
+      break;
+#endif
+    case 1000000:
+#ifdef I2C_TIMING_FMP
+      return I2C_TIMING_FMP;
+#else
+      index = I2C_SPEED_FREQ_FAST_PLUS;
+      speed = 1000000;
+      break;
+#endif
+  }
+
+  uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+  if ((I2C_ClockTiming[index].input_clock != pclk) || (I2C_ClockTiming[index].timing == 0U)) {
+    I2C_ClockTiming[index].input_clock = pclk;
+    I2C_ClockTiming[index].timing = I2C_TIMING_VALUE(pclk, speed);
+  }
+  return I2C_ClockTiming[index].timing;
+}
+
+/**
+* @brief  Return the SCL frequency a timing word gives at the current PCLK.
+* @param  timing : packed timing, see I2C_TIMING_VALUE()
+* @retval SCL frequency in Hz, 0 if the word is invalid
+*/
+static uint32_t i2c_getTimingSpeed(uint32_t timing)
+{
+  uint32_t ccr = I2C_TIMING_CCR(timing);
+  uint32_t divider = ccr & I2C_CCR_CCR;
+
+  if ((ccr & I2C_CCR_FS) == 0U) {
+    divider *= 2U;
+  } else if ((ccr & I2C_CCR_DUTY) != 0U) {
+    divider *= 25U;
+  } else {
+    divider *= 3U;
+  }
+  return (divider != 0U) ? (HAL_RCC_GetPCLK1Freq() / divider) : 0U;
+}
+/**
+* @brief  Blocking transfer timeout of a master transfer.
+* @note   Without the bus watchdog, I2C_XFER_TIMEOUT_TICK. Otherwise twice
+*         the time the address and data bytes take at the bus speed, plus
+*         the watchdog budget for clock stretching, at most
+*         I2C_XFER_TIMEOUT_TICK: a slave holding SCL low mid-transfer only
+*         blocks the bus that long.
+* @param  obj : pointer to i2c_t structure
+* @param  size : number of data bytes
+* @retval timeout in ms
+*/
+static uint32_t i2c_getXferTimeout(i2c_t *obj, uint16_t size)
+{
+  uint32_t speed = obj->handle.Init.ClockSpeed;
+  uint32_t timeout;
+
+  if ((obj->stallUs == 0U) || (speed == 0U)) {
+    return I2C_XFER_TIMEOUT_TICK;
+  }
+  /* 9 clocks per byte, address included */
+  timeout = 2U * ((((uint32_t)size + 1U) * 9U * 1000U + speed - 1U) / speed);
+  timeout += (obj->stallUs + 999U) / 1000U;
+  /* HAL_GetTick() granularity: at least one full tick */
+  timeout += 1U;
+  return (timeout < I2C_XFER_TIMEOUT_TICK) ? timeout : I2C_XFER_TIMEOUT_TICK;
+}
+#endif /* PY32F0xx */
+
 /**
   * @brief  Default init and setup GPIO and I2C peripheral
   * @param  obj : pointer to i2c_t structure
@@ -795,6 +917,14 @@ void i2c_custom_init(i2c_t *obj, uint32_t timing, uint32_t addressingMode, uint3
           /* Initialization Error */
           Error_Handler();
         }
+#if defined(PY32F0xx)
+        /* Re-init at the current speed (bus recovery) keeps the timing word
+         * applied last, which may be a raw one; otherwise use the cache */
+        if ((obj->timingValue == 0U) || (i2c_getTimingSpeed(obj->timingValue) != timing)) {
+          obj->timingValue = i2c_getTimingValue(i2c_getTiming(obj, timing));
+        }
+        i2c_setTimingValue(obj, obj->timingValue);
+#endif
 
         /* Initialize default values */
         obj->slaveRxNbData = 0;
@@ -826,7 +956,18 @@ void i2c_deinit(i2c_t *obj)
   */
 void i2c_setTiming(i2c_t *obj, uint32_t frequency)
 {
+  /* i2c_getTiming() has no timing above Fast-mode Plus: use the fastest */
+  if (frequency > 1000000) {
+    frequency = 1000000;
+  }
   uint32_t f = i2c_getTiming(obj, frequency);
+#if defined(PY32F0xx)
+  if (obj->isMaster == 1) {
+    /* Master only needs the speed registers: served from the timing cache */
+    i2c_setTimingValue(obj, i2c_getTimingValue(f));
+    return;
+  }
+#endif
   __HAL_I2C_DISABLE(&(obj->handle));
 
 #ifdef I2C_TIMING
@@ -845,6 +986,39 @@ void i2c_setTiming(i2c_t *obj, uint32_t frequency)
   __HAL_I2C_ENABLE(&(obj->handle));
 }
 
+#if defined(PY32F0xx)
+/**
+  * @brief  Apply a precomputed timing word. I2C must be configured before.
+  * @note   Only CR2.FREQ, TRISE and CCR are written, no HAL re-init and no
+  *         division is performed. The handle init parameters are updated so
+  *         that a later HAL_I2C_Init() keeps the same speed.
+  * @param  obj : pointer to i2c_t structure
+  * @param  timing : packed timing, see I2C_TIMING_VALUE()
+  * @retval none
+  */
+void i2c_setTimingValue(i2c_t *obj, uint32_t timing)
+{
+  I2C_TypeDef *i2c = obj->handle.Instance;
+  uint32_t ccr = I2C_TIMING_CCR(timing);
+
+  /* Record the speed the word really gives, so that a re-init finds it */
+  obj->timingValue = timing;
+  obj->handle.Init.ClockSpeed = i2c_getTimingSpeed(timing);
+  if ((ccr & I2C_CCR_FS) != 0U) {
+    obj->handle.Init.DutyCycle = ccr & I2C_CCR_DUTY;
+  } else {
+    obj->handle.Init.DutyCycle = I2C_DUTYCYCLE_2;
+  }
+
+  /* CCR and TRISE can only be written while the peripheral is disabled */
+  __HAL_I2C_DISABLE(&(obj->handle));
+  MODIFY_REG(i2c->CR2, I2C_CR2_FREQ, I2C_TIMING_FREQ(timing));
+  MODIFY_REG(i2c->TRISE, I2C_TRISE_TRISE, I2C_TIMING_TRISE(timing));
+  MODIFY_REG(i2c->CCR, (I2C_CCR_FS | I2C_CCR_DUTY | I2C_CCR_CCR), ccr);
+  __HAL_I2C_ENABLE(&(obj->handle));
+}
+#endif /* PY32F0xx */
+
 /**
   * @brief  Write bytes at a given address
   * @param  obj : pointer to i2c_t structure
@@ -874,7 +1048,7 @@ i2c_status_e i2c_master_write(i2c_t *obj, uint8_t dev_address,
 #if defined(I2C_OTHER_FRAME) && !defined(PY32F0xx)
       status = HAL_I2C_Master_Seq_Transmit_IT(&(obj->handle), dev_address, data, size, XferOptions);
 #elif defined(PY32F0xx)
-      status = HAL_I2C_Master_Transmit(&(obj->handle), dev_address, data, size, 1000);
+      status = HAL_I2C_Master_Transmit(&(obj->handle), dev_address, data, size, i2c_getXferTimeout(obj, size));
 #else
       status = HAL_I2C_Master_Transmit_IT(&(obj->handle), dev_address, data, size);
 #endif
@@ -886,7 +1060,7 @@ i2c_status_e i2c_master_write(i2c_t *obj, uint8_t dev_address,
           break;
         }
       } else {
-        ret = (status == HAL_OK) ? I2C_OK : I2C_ERROR;
+        ret = (status == HAL_OK) ? I2C_OK : ((status == HAL_TIMEOUT) ? I2C_TIMEOUT : I2C_ERROR);
       }
     } while (status == HAL_BUSY);
 
@@ -965,7 +1139,7 @@ i2c_status_e i2c_master_read(i2c_t *obj, uint8_t dev_address, uint8_t *data, uin
 #if defined(I2C_OTHER_FRAME) && !defined(PY32F0xx)
     status = HAL_I2C_Master_Seq_Receive_IT(&(obj->handle), dev_address, data, size, XferOptions);
 #elif defined(PY32F0xx)
-    status = HAL_I2C_Master_Receive(&(obj->handle), dev_address, data, size, 1000);
+    status = HAL_I2C_Master_Receive(&(obj->handle), dev_address, data, size, i2c_getXferTimeout(obj, size));
 #else
     status = HAL_I2C_Master_Receive_IT(&(obj->handle), dev_address, data, size);
 #endif
@@ -977,7 +1151,7 @@ i2c_status_e i2c_master_read(i2c_t *obj, uint8_t dev_address, uint8_t *data, uin
         break;
       }
     } else {
-      ret = (status == HAL_OK) ? I2C_OK : I2C_ERROR;
+      ret = (status == HAL_OK) ? I2C_OK : ((status == HAL_TIMEOUT) ? I2C_TIMEOUT : I2C_ERROR);
     }
   } while (status == HAL_BUSY);
 
@@ -1034,6 +1208,19 @@ i2c_status_e i2c_IsDeviceReady(i2c_t *obj, uint8_t devAddr, uint32_t trials)
   return ret;
 }
 
+/**
+  * @brief  Checks if the bus is idle: BUSY flag cleared and both lines high
+  * @param  obj : pointer to i2c_t structure
+  * @retval 1 if idle, 0 otherwise
+  */
+uint8_t i2c_isBusIdle(i2c_t *obj)
+{
+  if ((obj->handle.Instance != NULL) && (__HAL_I2C_GET_FLAG(&(obj->handle), I2C_FLAG_BUSY) != RESET)) {
+    return 0;
+  }
+  return (digitalReadFast(obj->sda) && digitalReadFast(obj->scl)) ? 1 : 0;
+}
+
 /* Aim of the function is to get i2c_s pointer using hi2c pointer */
 /* Highly inspired from magical linux kernel's "container_of" */
 /* (which was not directly used since not compatible with IAR toolchain) */
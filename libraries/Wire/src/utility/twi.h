@@ -123,6 +123,10 @@ struct i2c_s {
   uint8_t isMaster;
   uint8_t generalCall;
   uint8_t NoStretchMode;
+#if defined(PY32F0xx)
+  uint32_t timingValue; // Speed registers last applied, see I2C_TIMING_VALUE()
+  uint32_t stallUs;     // Bus watchdog budget, 0: transfers wait I2C_XFER_TIMEOUT_TICK
+#endif
 };
 
 ///@brief I2C state
@@ -136,17 +140,42 @@ typedef enum {
   I2C_BUSY = 6
 } i2c_status_e;
 
+#if defined(PY32F0xx)
+/* PY32F0xx I2C has no TIMINGR register: a timing word packs the speed
+ * related registers so that it can be computed once and applied with a few
+ * register writes.
+ *   [15:0]  CCR (FS, DUTY and CCR fields)
+ *   [21:16] TRISE
+ *   [29:24] CR2.FREQ (PCLK in MHz)
+ * I2C_TIMING_VALUE() is a constant expression: it can be used in variant.h
+ * (I2C_TIMING_SM/I2C_TIMING_FM/I2C_TIMING_FMP), in a static initializer or
+ * in a constexpr from sketch code.
+ */
+#define I2C_TIMING_CCR(t)             ((t) & 0xFFFFU)
+#define I2C_TIMING_TRISE(t)           (((t) >> 16U) & I2C_TRISE_TRISE)
+#define I2C_TIMING_FREQ(t)            (((t) >> 24U) & I2C_CR2_FREQ)
+#define I2C_TIMING_DUTY(speed)        (((speed) > 100000U) ? I2C_DUTYCYCLE_16_9 : I2C_DUTYCYCLE_2)
+#define I2C_TIMING_VALUE(pclk, speed) \
+  ((I2C_SPEED((pclk), (speed), I2C_TIMING_DUTY(speed)) & 0xFFFFU) | \
+   ((I2C_RISE_TIME(I2C_FREQRANGE(pclk), (speed)) & I2C_TRISE_TRISE) << 16U) | \
+   ((I2C_FREQRANGE(pclk) & I2C_CR2_FREQ) << 24U))
+#endif /* PY32F0xx */
+
 /* Exported functions ------------------------------------------------------- */
 void i2c_init(i2c_t *obj);
 void i2c_custom_init(i2c_t *obj, uint32_t timing, uint32_t addressingMode,
                      uint32_t ownAddress);
 void i2c_deinit(i2c_t *obj);
 void i2c_setTiming(i2c_t *obj, uint32_t frequency);
+#if defined(PY32F0xx)
+void i2c_setTimingValue(i2c_t *obj, uint32_t timing);
+#endif
 i2c_status_e i2c_master_write(i2c_t *obj, uint8_t dev_address, uint8_t *data, uint16_t size);
 i2c_status_e i2c_slave_write_IT(i2c_t *obj, uint8_t *data, uint16_t size);
 i2c_status_e i2c_master_read(i2c_t *obj, uint8_t dev_address, uint8_t *data, uint16_t size);
 
 i2c_status_e i2c_IsDeviceReady(i2c_t *obj, uint8_t devAddr, uint32_t trials);
+uint8_t i2c_isBusIdle(i2c_t *obj);
 
 void i2c_attachSlaveRxEvent(i2c_t *obj, void (*function)(i2c_t *));
 void i2c_attachSlaveTxEvent(i2c_t *obj, void (*function)(i2c_t *));